@@ -0,0 +1,109 @@
+//
+// BGZF block index and parallel decompression benchmark
+//
+// build and run on a host with pthreads using
+// gcc -O2 -DLIB_INFLATE_THREADS=16 -I.. bgzf_bench.c ../lib_inflate.c ../lib_inflate_bgzf.c -lpthread -o bgzf_bench
+// ./bgzf_bench file.gz
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lib_inflate.h"
+
+#define READ_SIZE 70001  // bytes per sequential read, not a block multiple
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[])
+{
+  FILE *f = (argc > 1) ? fopen(argv[1], "rb") : NULL;
+  unsigned char *pCompressed, *pUncompressed;
+  unsigned int iCompressedSize, iUncompressedSize, num = 0, i, decSize;
+  lib_inflate_bgzf_block *pBlocks;
+  int res;
+  double t;
+  if (!f) {
+    printf("usage: bgzf_bench file.gz\n");
+    return 1;
+  }
+  fseek(f, 0, SEEK_END);
+  iCompressedSize = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  pCompressed = (unsigned char *)malloc(iCompressedSize);
+  if (!pCompressed || fread(pCompressed, 1, iCompressedSize, f) != iCompressedSize) {
+    printf("Can't read %s\n", argv[1]);
+    return 1;
+  }
+  fclose(f);
+
+  t = now();
+  res = lib_inflate_bgzf_index(NULL, &num, pCompressed, iCompressedSize);
+  pBlocks = (lib_inflate_bgzf_block *)malloc(num * sizeof(*pBlocks));
+  if ((res != LIB_INFLATE_SUCCESS) || !pBlocks) {
+    printf("Not a BGZF file %d\n", res);
+    return 1;
+  }
+  lib_inflate_bgzf_index(pBlocks, &num, pCompressed, iCompressedSize);
+  t = now() - t;
+  iUncompressedSize = num ? pBlocks[num - 1].destOffset + pBlocks[num - 1].destLen : 0;
+  printf("Indexed %u blocks compressed %uB uncompressed %uB in %.2fms\n", num, iCompressedSize, iUncompressedSize, t * 1e3);
+
+  pUncompressed = (unsigned char *)malloc(iUncompressedSize + 1);
+  t = now();
+  for (i = 0; i < num; i ++) {
+    decSize = pBlocks[i].destLen;
+    res = lib_inflate_gzip_uncompress(pUncompressed + pBlocks[i].destOffset, &decSize, pCompressed + pBlocks[i].srcOffset, pBlocks[i].srcLen);
+    if (res != LIB_INFLATE_SUCCESS) {
+      break;
+    }
+  }
+  t = now() - t;
+  printf("Uncompressed block by block %d in %.1fms = %.0fMB/s\n", res, t * 1e3, iUncompressedSize / t / 1e6);
+
+  decSize = iUncompressedSize;
+  t = now();
+  res = lib_inflate_bgzf_uncompress(pUncompressed, &decSize, pCompressed, pBlocks, num);
+  t = now() - t;
+  printf("Uncompressed with %d threads %d in %.1fms = %.0fMB/s\n", LIB_INFLATE_THREADS, res, t * 1e3, iUncompressedSize / t / 1e6);
+
+  // read sequentially until a read returns no data, it must end at the end
+  {
+    lib_inflate_bgzf_reader reader;
+    unsigned char *pCache = (unsigned char *)malloc(LIB_INFLATE_BGZF_CACHE * LIB_INFLATE_BGZF_BLOCK);
+    unsigned char *pRead = (unsigned char *)malloc(iUncompressedSize + READ_SIZE);
+    unsigned long long vo = 0;
+    unsigned int iRead = 0, calls = 0;
+    if (!pCache || !pRead) {
+      printf("Out of memory\n");
+      return 1;
+    }
+    lib_inflate_bgzf_open(&reader, pCompressed, pBlocks, num, pCache);
+    t = now();
+    do {
+      decSize = READ_SIZE;
+      res = lib_inflate_bgzf_read(&reader, &vo, pRead + iRead, &decSize);
+      iRead += decSize;
+      calls ++;
+    } while ((res == LIB_INFLATE_SUCCESS) && decSize && (iRead <= iUncompressedSize));
+    t = now() - t;
+    res = (res == LIB_INFLATE_SUCCESS) && (iRead == iUncompressedSize) && !memcmp(pRead, pUncompressed, iRead);
+    printf("Read sequentially in %u calls %uB in %.1fms = %.0fMB/s %s\n", calls, iRead, t * 1e3, iRead / t / 1e6,
+      res ? "OK" : "FAILED");
+    free(pRead);
+    free(pCache);
+    if (!res) {
+      return 1;
+    }
+  }
+
+  free(pUncompressed);
+  free(pBlocks);
+  free(pCompressed);
+  return 0;
+}
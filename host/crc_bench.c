@@ -0,0 +1,47 @@
+//
+// CRC32 scaling benchmark for lib_inflate_crc32_parallel
+//
+// build and run on a host with pthreads using
+// gcc -O2 -DLIB_INFLATE_THREADS=16 -I.. crc_bench.c ../lib_inflate.c -lpthread -o crc_bench
+// ./crc_bench [MB]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "lib_inflate.h"
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned int size = ((argc > 1) ? atoi(argv[1]) : 64) << 20;
+  unsigned char *pData = (unsigned char *)malloc(size);
+  unsigned int i, threads, crc, crc1 = 0;
+  double t, t1 = 0;
+  if (!pData) {
+    printf("Not enough memory for %u\n", size);
+    return 1;
+  }
+  for (i = 0; i < size; i ++) {
+    pData[i] = (unsigned char)((i * 2654435761u) >> 24);
+  }
+  printf("CRC32 of %uMB with up to %d threads\n", size >> 20, LIB_INFLATE_THREADS);
+  for (threads = 1; threads <= LIB_INFLATE_THREADS; threads *= 2) {
+    t = now();
+    crc = lib_inflate_crc32_parallel(pData, size, threads);
+    t = now() - t;
+    if (threads == 1) {
+      crc1 = crc;
+      t1 = t;
+    }
+    printf("%2u threads crc %08x %s in %.1fms = %.0fMB/s speedup %.2f\n", threads, crc,
+      (crc == crc1) ? "OK" : "MISMATCH", t * 1e3, (size >> 20) / t, t1 / t);
+  }
+  free(pData);
+  return 0;
+}
@@ -0,0 +1,230 @@
+//
+// gzrom container builder
+//
+// Turns a gzip image into a gzrom container for lib_inflate_gzrom_uncompress
+// and lib_inflate_gzromExecute. The image is decoded once at build time:
+// the trees of each block go to ROM, identical trees are shared, and the
+// data of each block is shifted to start on a byte boundary. The CRC32 is
+// checked here and the container is flagged as verified unless -c keeps
+// the check at boot. The container is written as C source, decoded again
+// from memory to check it and both decoders are timed.
+//
+// build and run on a host using
+// gcc -O2 -I.. gzrom_build.c ../lib_inflate.c -o gzrom_build
+// ./gzrom_build [-c] image.gz ../lib_inflate_gzrom_image.c
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lib_inflate.h"
+
+#define RUNS 10
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static unsigned int treeSymbols(const lib_inflate_tree *t)
+{
+  unsigned int i, n = 0;
+  for (i = 0; i < 16; i ++) {
+    n += t->counts[i];
+  }
+  return n;
+}
+
+static int sameTree(const lib_inflate_tree *a, const lib_inflate_tree *b)
+{
+  return (a->max_sym == b->max_sym) && !memcmp(a->counts, b->counts, sizeof(a->counts))
+    && !memcmp(a->symbols, b->symbols, treeSymbols(a) * sizeof(a->symbols[0]));
+}
+
+static void printTree(FILE *f, const lib_inflate_tree *t)
+{
+  unsigned int i, n = treeSymbols(t);
+  fprintf(f, "  { {");
+  for (i = 0; i < 16; i ++) {
+    fprintf(f, " %u,", t->counts[i]);
+  }
+  fprintf(f, " },\n    {");
+  for (i = 0; i < n; i ++) {
+    fprintf(f, "%s%u,", (i && !(i % 16)) ? "\n     " : " ", t->symbols[i]);
+  }
+  fprintf(f, " }, %d },\n", t->max_sym);
+}
+
+int main(int argc, char *argv[])
+{
+  int arg = 1, verify = 1, res;
+  FILE *f;
+  unsigned char *pCompressed, *pUncompressed, *pCheck, *pData;
+  unsigned int iCompressedSize, iUncompressedSize, num = 0, numTrees = 0, iData = 0, i, j, decSize;
+  lib_inflate_gzrom_scan_block *pScan;
+  lib_inflate_gzrom_block *pBlocks;
+  lib_inflate_tree *pTrees;
+  lib_inflate_gzrom rom;
+  double t, tGzip = 1e9, tRom = 1e9;
+  if ((argc > 1) && !strcmp(argv[1], "-c")) {
+    verify = 0;
+    arg ++;
+  }
+  if (argc < arg + 2) {
+    printf("usage: gzrom_build [-c] image.gz image.c\n");
+    return 1;
+  }
+  f = fopen(argv[arg], "rb");
+  if (!f) {
+    printf("Can't open %s\n", argv[arg]);
+    return 1;
+  }
+  fseek(f, 0, SEEK_END);
+  iCompressedSize = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  pCompressed = (unsigned char *)malloc(iCompressedSize);
+  if (!pCompressed || fread(pCompressed, 1, iCompressedSize, f) != iCompressedSize || iCompressedSize < 18) {
+    printf("Can't read %s\n", argv[arg]);
+    return 1;
+  }
+  fclose(f);
+  iUncompressedSize = lib_inflate_gzip_size(pCompressed, iCompressedSize);
+  pUncompressed = (unsigned char *)malloc(iUncompressedSize + 1);
+  pCheck = (unsigned char *)malloc(iUncompressedSize + 1);
+
+  // decode once to count the blocks, again to record them
+  decSize = iUncompressedSize;
+  res = lib_inflate_gzrom_scan(NULL, NULL, &num, pUncompressed, &decSize, pCompressed, iCompressedSize);
+  pScan = (lib_inflate_gzrom_scan_block *)malloc((num + 1) * sizeof(*pScan));
+  pBlocks = (lib_inflate_gzrom_block *)malloc((num + 1) * sizeof(*pBlocks));
+  pTrees = (lib_inflate_tree *)malloc((2 * num + 1) * sizeof(*pTrees));
+  pData = (unsigned char *)malloc(iCompressedSize + num);
+  if ((res != LIB_INFLATE_SUCCESS) || !pUncompressed || !pCheck || !pScan || !pBlocks || !pTrees || !pData) {
+    printf("Can't decode %s %d\n", argv[arg], res);
+    return 1;
+  }
+  decSize = iUncompressedSize;
+  lib_inflate_gzrom_scan(pScan, pTrees, &num, pUncompressed, &decSize, pCompressed, iCompressedSize);
+
+  for (i = 0; i < num; i ++) {
+    lib_inflate_gzrom_scan_block *s = &pScan[i];
+    lib_inflate_gzrom_block *b = &pBlocks[i];
+    unsigned int bit = s->srcBitOffset, len = (s->srcBitLen + 7) / 8;
+    // shift the block data to a byte boundary, the gzip trailer follows
+    // the last block so reading one byte ahead stays in the image
+    for (j = 0; j < len; j ++, bit += 8) {
+      pData[iData + j] = (pCompressed[bit / 8] >> (bit % 8)) | (pCompressed[bit / 8 + 1] << (8 - bit % 8));
+    }
+    if (s->srcBitLen % 8) {
+      pData[iData + len - 1] &= (1 << (s->srcBitLen % 8)) - 1;
+    }
+    b->srcOffset = iData;
+    b->srcLen = len;
+    b->destOffset = s->destOffset;
+    b->destLen = s->destLen;
+    b->btype = s->btype;
+    iData += len;
+    // share identical trees, the fixed trees of all fixed blocks
+    if (s->btype) {
+      lib_inflate_tree *lt = &pTrees[s->tree], *dt = &pTrees[s->tree + 1];
+      for (j = 0; j < numTrees; j += 2) {
+        if (sameTree(&pTrees[j], lt) && sameTree(&pTrees[j + 1], dt)) {
+          break;
+        }
+      }
+      if (j == numTrees) {
+        pTrees[numTrees] = *lt;
+        pTrees[numTrees + 1] = *dt;
+        numTrees += 2;
+      }
+      if (j > 0xFFFF) {
+        printf("Too many trees in %s\n", argv[arg]);
+        return 1;
+      }
+      b->tree = j;
+    }
+    else {
+      b->tree = 0;
+    }
+  }
+
+  rom.flags = verify ? LIB_INFLATE_GZROM_CRC_VERIFIED : 0;
+  rom.crc = pCompressed[iCompressedSize - 8] | (pCompressed[iCompressedSize - 7] << 8) |
+    (pCompressed[iCompressedSize - 6] << 16) | ((unsigned int)pCompressed[iCompressedSize - 5] << 24);
+  rom.len = decSize;
+  rom.num = num;
+  rom.numTrees = numTrees;
+  rom.dataLen = iData;
+  rom.pBlocks = pBlocks;
+  rom.pTrees = pTrees;
+  rom.pData = pData;
+
+  // the container must decode to the same data, the CRC is checked once
+  rom.flags &= ~LIB_INFLATE_GZROM_CRC_VERIFIED;
+  decSize = iUncompressedSize;
+  memset(pCheck, 0, iUncompressedSize);
+  res = lib_inflate_gzrom_uncompress(pCheck, &decSize, &rom);
+  if ((res != LIB_INFLATE_SUCCESS) || (decSize != rom.len) || memcmp(pCheck, pUncompressed, rom.len)) {
+    printf("Container does not match %d\n", res);
+    return 1;
+  }
+  rom.flags = verify ? LIB_INFLATE_GZROM_CRC_VERIFIED : 0;
+  for (i = 0; i < RUNS; i ++) {
+    decSize = iUncompressedSize;
+    t = now();
+    lib_inflate_gzip_uncompress(pCheck, &decSize, pCompressed, iCompressedSize);
+    t = now() - t;
+    tGzip = (t < tGzip) ? t : tGzip;
+    decSize = iUncompressedSize;
+    t = now();
+    lib_inflate_gzrom_uncompress(pCheck, &decSize, &rom);
+    t = now() - t;
+    tRom = (t < tRom) ? t : tRom;
+  }
+
+  f = fopen(argv[arg + 1], "w");
+  if (!f) {
+    printf("Can't create %s\n", argv[arg + 1]);
+    return 1;
+  }
+  fprintf(f, "#include \"lib_inflate.h\"\n\n");
+  fprintf(f, "// gzrom container of %s built with host/gzrom_build.c\n\n", argv[arg]);
+  fprintf(f, "static const U1 gzromData[] = {\n");
+  for (i = 0; i < iData; i ++) {
+    if (!(i % 16)) {
+      fprintf(f, "  /*%08x*/", i);
+    }
+    fprintf(f, " 0x%02x,%s", pData[i], ((i % 16 == 15) || (i + 1 == iData)) ? "\n" : "");
+  }
+  fprintf(f, "};\n\nstatic const lib_inflate_gzrom_block gzromBlocks[] = {\n");
+  for (i = 0; i < num; i ++) {
+    fprintf(f, "  { %u, %u, %u, %u, %u, %u },\n", pBlocks[i].srcOffset, pBlocks[i].srcLen,
+      pBlocks[i].destOffset, pBlocks[i].destLen, pBlocks[i].btype, pBlocks[i].tree);
+  }
+  fprintf(f, "};\n\n");
+  if (numTrees) {
+    fprintf(f, "static const lib_inflate_tree gzromTrees[] = {\n");
+    for (i = 0; i < numTrees; i ++) {
+      printTree(f, &pTrees[i]);
+    }
+    fprintf(f, "};\n\n");
+  }
+  fprintf(f, "const lib_inflate_gzrom lib_inflate_gzromImage = {\n  %s, 0x%08x, %u, %u, %u, %u,\n  gzromBlocks, %s, gzromData\n};\n",
+    verify ? "LIB_INFLATE_GZROM_CRC_VERIFIED" : "0", rom.crc, rom.len, rom.num, rom.numTrees, rom.dataLen,
+    numTrees ? "gzromTrees" : "0");
+  fclose(f);
+
+  printf("%s: %u blocks %u trees compressed %uB container %uB data + %uB trees uncompressed %uB\n", argv[arg], num, numTrees,
+    iCompressedSize, iData, numTrees * (unsigned int)sizeof(lib_inflate_tree), rom.len);
+  printf("gzip %.3fms gzrom %.3fms%s\n", tGzip * 1e3, tRom * 1e3, verify ? " CRC verified at build time" : "");
+  free(pData);
+  free(pTrees);
+  free(pBlocks);
+  free(pScan);
+  free(pCheck);
+  free(pUncompressed);
+  free(pCompressed);
+  return 0;
+}
@@ -0,0 +1,458 @@
+//
+// Linux host port of ubx_gunzip.ino
+//
+// Fetches gzip data over HTTP and decompresses it two ways:
+// - sequential: receive the whole body, then lib_inflate_gzip_uncompress
+//   as the sketch does
+// - pipelined: a receive thread fills a lock-free single producer single
+//   consumer ring of buffers while lib_inflate_gzip_uncompress_stream
+//   consumes it, so decoding overlaps the transfer
+// Handles Content-Encoding: gzip, Content-Length and chunked transfer
+// encoding and reports the time until the first window of output and the
+// end to end latency. The streaming decoder hands out its output in 32 kB
+// windows, so the first window arrives once 32 kB are decoded or the data
+// ends. The sequential run has all output at once, at the end.
+//
+// build using
+// gcc -O2 -I.. http_gunzip.c ../lib_inflate.c -lpthread -o http_gunzip
+//
+// fetch from a server
+// ./http_gunzip http://127.0.0.1:8000/tinf-master.zip.gz
+// or serve a file on a loopback port, chunked and throttled to 500kB/s
+// ./http_gunzip -l ../tinf-master.zip.gz 500
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "lib_inflate.h"
+
+#define RING_SLOTS 16        // buffers in the ring
+#define RING_SLOT_SIZE 16384 // size of each buffer
+#define SERVE_CHUNK 4096     // chunk size of the loopback server
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// -- HTTP client --
+
+typedef struct {
+  int fd;
+  unsigned char buf[RING_SLOT_SIZE]; // raw receive buffer
+  unsigned int pos, len;
+  int chunked;                       // Transfer-Encoding: chunked
+  int gzip;                          // Content-Encoding: gzip
+  long left;                         // bytes left in chunk or body, -1 until connection close
+  int eof;
+} HttpConn;
+
+static int connFill(HttpConn *c)
+{
+  ssize_t n = recv(c->fd, c->buf, sizeof(c->buf), 0);
+  c->pos = 0;
+  c->len = (n > 0) ? (unsigned int)n : 0;
+  return (n > 0);
+}
+
+static int connGetc(HttpConn *c)
+{
+  if ((c->pos == c->len) && !connFill(c)) {
+    return -1;
+  }
+  return c->buf[c->pos++];
+}
+
+// read a header or chunk size line without the CRLF
+static int connLine(HttpConn *c, char *line, int max)
+{
+  int ch, n = 0;
+  while (((ch = connGetc(c)) >= 0) && (ch != '\n')) {
+    if ((ch != '\r') && (n < max - 1)) {
+      line[n++] = (char)ch;
+    }
+  }
+  line[n] = 0;
+  return (ch >= 0) || (n > 0);
+}
+
+static int httpGet(HttpConn *c, const char *url)
+{
+  char host[256], line[1024];
+  const char *path, *port = "80";
+  struct addrinfo hints, *ai;
+  const char *p;
+  int status = 0;
+  if (strncmp(url, "http://", 7) != 0) {
+    printf("Only http:// URLs are supported\n");
+    return 0;
+  }
+  url += 7;
+  path = strchr(url, '/');
+  if (!path) {
+    path = "/";
+  }
+  snprintf(host, sizeof(host), "%.*s", (int)(strcspn(url, "/")), url);
+  p = strchr(host, ':');
+  if (p) {
+    host[p - host] = 0;
+    port = p + 1;
+  }
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(host, port, &hints, &ai) != 0) {
+    printf("Can't resolve %s\n", host);
+    return 0;
+  }
+  memset(c, 0, sizeof(*c));
+  c->left = -1;
+  c->fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+  if ((c->fd < 0) || (connect(c->fd, ai->ai_addr, ai->ai_addrlen) != 0)) {
+    printf("Can't connect to %s:%s\n", host, port);
+    freeaddrinfo(ai);
+    return 0;
+  }
+  freeaddrinfo(ai);
+  snprintf(line, sizeof(line), "GET %s HTTP/1.1\r\nHost: %s\r\nAccept-Encoding: gzip\r\nConnection: close\r\n\r\n", path, host);
+  send(c->fd, line, strlen(line), 0);
+
+  // status line and headers
+  if (connLine(c, line, sizeof(line))) {
+    sscanf(line, "HTTP/%*s %d", &status);
+  }
+  while (connLine(c, line, sizeof(line)) && line[0]) {
+    if (!strncasecmp(line, "Content-Length:", 15)) {
+      c->left = atol(line + 15);
+    } else if (!strncasecmp(line, "Transfer-Encoding:", 18) && strstr(line, "chunked")) {
+      c->chunked = 1;
+    } else if (!strncasecmp(line, "Content-Encoding:", 17) && strstr(line, "gzip")) {
+      c->gzip = 1;
+    }
+  }
+  if (c->chunked) {
+    c->left = 0; // chunk size follows
+  }
+  if (status != 200) {
+    printf("Error on HTTP request: %d\n", status);
+    close(c->fd);
+    return 0;
+  }
+  return 1;
+}
+
+// read up to max bytes of the body, returns 0 at its end
+static unsigned int httpRead(HttpConn *c, unsigned char *p, unsigned int max)
+{
+  unsigned int n;
+  char line[64];
+  if (c->eof) {
+    return 0;
+  }
+  if (c->chunked && (c->left == 0)) {
+    if (!connLine(c, line, sizeof(line)) || ((c->left = strtol(line, NULL, 16)) <= 0)) {
+      // last chunk, skip the trailer
+      while (connLine(c, line, sizeof(line)) && line[0]);
+      c->eof = 1;
+      return 0;
+    }
+  }
+  if ((c->pos == c->len) && !connFill(c)) {
+    c->eof = 1;
+    return 0;
+  }
+  n = c->len - c->pos;
+  if (n > max) {
+    n = max;
+  }
+  if ((c->left >= 0) && (n > (unsigned long)c->left)) {
+    n = (unsigned int)c->left;
+  }
+  memcpy(p, c->buf + c->pos, n);
+  c->pos += n;
+  if (c->left >= 0) {
+    c->left -= n;
+    if (c->chunked && (c->left == 0)) {
+      connLine(c, line, sizeof(line)); // CRLF after the chunk data
+    } else if (!c->chunked && (c->left == 0)) {
+      c->eof = 1;
+    }
+  }
+  return n;
+}
+
+// -- Sequential: receive all, then decompress --
+
+static void runSequential(const char *url)
+{
+  HttpConn *c = (HttpConn *)malloc(sizeof(HttpConn));
+  unsigned char *pCompressed = NULL, *pUncompressed;
+  unsigned int iCompressedSize = 0, iUncompressedSize, decSize, n, size = 0;
+  double t0 = now(), t1, t2;
+  int res;
+  if (!c || !httpGet(c, url)) {
+    free(c);
+    return;
+  }
+  do {
+    if (size - iCompressedSize < RING_SLOT_SIZE) {
+      unsigned char *pGrown;
+      size = size * 2 + RING_SLOT_SIZE;
+      pGrown = (unsigned char *)realloc(pCompressed, size);
+      if (!pGrown) {
+        printf("Not enough memory\n");
+        close(c->fd);
+        free(pCompressed);
+        free(c);
+        return;
+      }
+      pCompressed = pGrown;
+    }
+    n = httpRead(c, pCompressed + iCompressedSize, RING_SLOT_SIZE);
+    iCompressedSize += n;
+  } while (n > 0);
+  close(c->fd);
+  t1 = now();
+  if ((iCompressedSize > 18) && (pCompressed[0] == 0x1f) && (pCompressed[1] == 0x8b)) {
+    iUncompressedSize = lib_inflate_gzip_size(pCompressed, iCompressedSize);
+    pUncompressed = (unsigned char *)malloc(iUncompressedSize + 1);
+    if (!pUncompressed) {
+      printf("Not enough memory\n");
+    } else {
+      decSize = iUncompressedSize;
+      res = lib_inflate_gzip_uncompress(pUncompressed, &decSize, pCompressed, iCompressedSize);
+      t2 = now();
+      printf("Sequential %d compressed %uB uncompressed %uB receive %.1fms first window %.1fms end to end %.1fms\n",
+        res, iCompressedSize, decSize, (t1 - t0) * 1e3, (t2 - t0) * 1e3, (t2 - t0) * 1e3);
+      free(pUncompressed);
+    }
+  } else {
+    printf("It's not a gzip file, something went wrong :(\n");
+  }
+  free(pCompressed);
+  free(c);
+}
+
+// -- Pipelined: receive thread and inflater share a ring of buffers --
+
+typedef struct {
+  HttpConn conn;
+  unsigned char data[RING_SLOTS][RING_SLOT_SIZE];
+  unsigned int len[RING_SLOTS];
+  atomic_uint head;        // next slot to fill, written by the receiver only
+  atomic_uint tail;        // next slot to consume, written by the inflater only
+  atomic_int done;         // receiver reached the end of the body
+  int holding;             // inflater still uses the slot at tail
+  unsigned int iCompressedSize;
+  unsigned int iUncompressedSize;
+  double t0, tFirst, tReceived; // tFirst when the first window is written
+} Pipe;
+
+static void *receiver(void *arg)
+{
+  Pipe *p = (Pipe *)arg;
+  unsigned int head = atomic_load_explicit(&p->head, memory_order_relaxed);
+  for (;;) {
+    unsigned int n;
+    while (head - atomic_load_explicit(&p->tail, memory_order_acquire) == RING_SLOTS) {
+      sched_yield(); // ring full, wait for the inflater
+    }
+    n = httpRead(&p->conn, p->data[head % RING_SLOTS], RING_SLOT_SIZE);
+    if (n == 0) {
+      break;
+    }
+    p->len[head % RING_SLOTS] = n;
+    p->iCompressedSize += n;
+    atomic_store_explicit(&p->head, ++head, memory_order_release);
+  }
+  p->tReceived = now();
+  atomic_store_explicit(&p->done, 1, memory_order_release);
+  return NULL;
+}
+
+static U4 pipeRead(void *pCtx, const U1 **ppData)
+{
+  Pipe *p = (Pipe *)pCtx;
+  unsigned int tail = atomic_load_explicit(&p->tail, memory_order_relaxed);
+  if (p->holding) {
+    // give the previous slot back to the receiver
+    atomic_store_explicit(&p->tail, ++tail, memory_order_release);
+    p->holding = 0;
+  }
+  while (atomic_load_explicit(&p->head, memory_order_acquire) == tail) {
+    if (atomic_load_explicit(&p->done, memory_order_acquire)
+     && (atomic_load_explicit(&p->head, memory_order_acquire) == tail)) {
+      return 0;
+    }
+    sched_yield(); // ring empty, wait for the receiver
+  }
+  p->holding = 1;
+  *ppData = p->data[tail % RING_SLOTS];
+  return p->len[tail % RING_SLOTS];
+}
+
+static void pipeWrite(void *pCtx, const U1 *pData, U4 len)
+{
+  Pipe *p = (Pipe *)pCtx;
+  UNUSED(pData);
+  if (!p->iUncompressedSize && len) {
+    p->tFirst = now();
+  }
+  p->iUncompressedSize += len;
+}
+
+static void runPipelined(const char *url)
+{
+  Pipe *p = (Pipe *)calloc(1, sizeof(Pipe));
+  unsigned char *pWindow = (unsigned char *)malloc(LIB_INFLATE_WINDOW_SIZE);
+  const U1 *pRest;
+  pthread_t thread;
+  unsigned int decSize = 0;
+  double t2;
+  int res;
+  if (!p || !pWindow) {
+    printf("Not enough memory\n");
+  } else {
+    p->t0 = now();
+    if (httpGet(&p->conn, url)) {
+      if (!p->conn.gzip) {
+        printf("No Content-Encoding: gzip, trying anyway\n");
+      }
+      pthread_create(&thread, NULL, receiver, p);
+      res = lib_inflate_gzip_uncompress_stream(pipeRead, pipeWrite, p, pWindow, &decSize);
+      // drain the ring so the receiver can finish on errors
+      while (pipeRead(p, &pRest) > 0);
+      pthread_join(thread, NULL);
+      t2 = now();
+      close(p->conn.fd);
+      printf("Pipelined  %d compressed %uB uncompressed %uB receive %.1fms first window %.1fms end to end %.1fms\n",
+        res, p->iCompressedSize, decSize, (p->tReceived - p->t0) * 1e3,
+        ((p->tFirst > 0) ? p->tFirst - p->t0 : t2 - p->t0) * 1e3, (t2 - p->t0) * 1e3);
+    }
+  }
+  free(pWindow);
+  free(p);
+}
+
+// -- Loopback server --
+
+typedef struct {
+  int fd;
+  unsigned char *pData;
+  unsigned int iSize;
+  unsigned int rate; // kB/s, 0 unthrottled
+} Server;
+
+static void *server(void *arg)
+{
+  Server *s = (Server *)arg;
+  const char *hdr = "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\n"
+                    "Content-Encoding: gzip\r\nTransfer-Encoding: chunked\r\nConnection: close\r\n\r\n";
+  for (;;) {
+    char req[1024], line[32];
+    unsigned int pos, n;
+    int fd = accept(s->fd, NULL, NULL);
+    if (fd < 0) {
+      break;
+    }
+    recv(fd, req, sizeof(req), 0);
+    send(fd, hdr, strlen(hdr), 0);
+    for (pos = 0; pos < s->iSize; pos += n) {
+      n = (s->iSize - pos < SERVE_CHUNK) ? s->iSize - pos : SERVE_CHUNK;
+      snprintf(line, sizeof(line), "%x\r\n", n);
+      send(fd, line, strlen(line), 0);
+      send(fd, s->pData + pos, n, 0);
+      send(fd, "\r\n", 2, 0);
+      if (s->rate) {
+        usleep(n * 1000u / s->rate);
+      }
+    }
+    send(fd, "0\r\n\r\n", 5, 0);
+    close(fd);
+  }
+  return NULL;
+}
+
+static int serve(Server *s, const char *file, unsigned int rate, char *url, int max)
+{
+  struct sockaddr_in addr;
+  socklen_t alen = sizeof(addr);
+  pthread_t thread;
+  const char *name;
+  FILE *f = fopen(file, "rb");
+  if (!f) {
+    printf("Can't open %s\n", file);
+    return 0;
+  }
+  fseek(f, 0, SEEK_END);
+  s->iSize = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  s->pData = (unsigned char *)malloc(s->iSize);
+  if (!s->pData || (fread(s->pData, 1, s->iSize, f) != s->iSize)) {
+    fclose(f);
+    printf("Can't read %s\n", file);
+    return 0;
+  }
+  fclose(f);
+  s->rate = rate;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  s->fd = socket(AF_INET, SOCK_STREAM, 0);
+  if ((s->fd < 0) || bind(s->fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(s->fd, 4)
+   || getsockname(s->fd, (struct sockaddr *)&addr, &alen)) {
+    printf("Can't listen on loopback\n");
+    return 0;
+  }
+  name = strrchr(file, '/');
+  snprintf(url, max, "http://127.0.0.1:%d/%s", ntohs(addr.sin_port), name ? name + 1 : file);
+  pthread_create(&thread, NULL, server, s);
+  pthread_detach(thread);
+  return 1;
+}
+
+int main(int argc, char *argv[])
+{
+  static Server s;
+  char url[512];
+  int i;
+  printf(
+    "HTTP UBLOX GUNZIP with "
+#ifdef LIB_INFLATE_ERROR_ENABLED
+      " ERROR"
+#endif
+#ifdef LIB_INFLATE_CRC_ENABLED
+      " CRC"
+#endif
+    "\n");
+  if ((argc > 2) && !strcmp(argv[1], "-l")) {
+    if (!serve(&s, argv[2], (argc > 3) ? atoi(argv[3]) : 0, url, sizeof(url))) {
+      return 1;
+    }
+    printf("GET %s\n", url);
+    runSequential(url);
+    runPipelined(url);
+  } else if (argc > 1) {
+    for (i = 1; i < argc; i ++) {
+      printf("GET %s\n", argv[i]);
+      runSequential(argv[i]);
+      runPipelined(argv[i]);
+    }
+  } else {
+    printf("usage: http_gunzip URL... | -l file.gz [kB/s]\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,232 @@
+//
+// Large stream benchmark
+//
+// Synthesises a gzip stream of more than 4 GB on the fly and decompresses
+// it through the window with lib_inflate_gzip_uncompress_stream64. Each
+// round of the stream is a stored block of random bytes and a block with
+// fixed trees of 258 byte matches from all over the window, so matches
+// and snapshots keep working past the point where 32 bit counters wrap.
+// The full size and the CRC32 are checked, the trailer only has the size
+// modulo 2^32. The throughput of each GB is printed, it should stay flat.
+// With a file name the stream is also written to it and decompressed
+// again from the mapped file with lib_inflate_gzip_uncompress_file64.
+//
+// build and run on a host with pthreads using
+// gcc -O2 -DLIB_INFLATE_THREADS=1 -I.. large_bench.c ../lib_inflate.c ../lib_inflate_readahead.c -lpthread -o large_bench
+// ./large_bench [GB] [file.gz]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "lib_inflate.h"
+
+#define GB            (1ULL << 30)
+#define MATCH_LEN     258
+#define ROUND_STORED  4096   // random bytes per round
+#define ROUND_MATCHES 1024   // matches per round
+#define ROUND_OUT     (ROUND_STORED + ROUND_MATCHES * MATCH_LEN)
+
+static const unsigned short distBase[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+  1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const unsigned char distBits[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+typedef struct {
+  unsigned long long iTarget;  // uncompressed bytes to synthesise
+  unsigned long long iTotal;   // uncompressed bytes synthesised
+  unsigned int crc;
+  unsigned int seed;
+  int state;                   // 0 header, 1 rounds, 2 end
+  unsigned char hist[LIB_INFLATE_WINDOW_SIZE + ROUND_OUT];
+  unsigned char out[16384];
+  unsigned int iOut;
+  unsigned long long bits;
+  int nbits;
+  double tSynth;               // time spent synthesising
+  FILE *f;                     // copy of the stream or NULL
+  // output side
+  unsigned long long iWritten;
+  unsigned long long iNextGb;
+  double tGb, tSynthGb;
+} synth;
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static unsigned int rnd(synth *s)
+{
+  s->seed ^= s->seed << 13;
+  s->seed ^= s->seed >> 17;
+  s->seed ^= s->seed << 5;
+  return s->seed;
+}
+
+static void putBits(synth *s, unsigned int v, int n)
+{
+  s->bits |= (unsigned long long)v << s->nbits;
+  s->nbits += n;
+  while (s->nbits >= 8) {
+    s->out[s->iOut ++] = (unsigned char)s->bits;
+    s->bits >>= 8;
+    s->nbits -= 8;
+  }
+}
+
+// Huffman codes go out most significant bit first
+static void putCode(synth *s, unsigned int code, int n)
+{
+  while (n --) {
+    putBits(s, (code >> n) & 1, 1);
+  }
+}
+
+static void alignBits(synth *s)
+{
+  if (s->nbits) {
+    putBits(s, 0, 8 - s->nbits);
+  }
+}
+
+// a stored block of random bytes and a fixed block of matches into the window
+static void synthRound(synth *s, int last)
+{
+  unsigned char *p = s->hist + LIB_INFLATE_WINDOW_SIZE;
+  unsigned int i, k, n = 0;
+  putBits(s, 0, 3);
+  alignBits(s);
+  putBits(s, ROUND_STORED, 16);
+  putBits(s, ~ROUND_STORED & 0xFFFF, 16);
+  for (i = 0; i < ROUND_STORED; i ++) {
+    p[n] = rnd(s) >> 24;
+    s->out[s->iOut ++] = p[n ++];
+  }
+  putBits(s, last, 1);
+  putBits(s, 1, 2);
+  for (i = 0; i < ROUND_MATCHES; i ++) {
+    unsigned long long avail = s->iTotal + n;
+    unsigned int dist = 1 + rnd(s) % ((avail < LIB_INFLATE_WINDOW_SIZE) ? (unsigned int)avail : LIB_INFLATE_WINDOW_SIZE);
+    int c = 29;
+    while (distBase[c] > dist) {
+      c --;
+    }
+    putCode(s, 0xC5, 8);  // length 258
+    putCode(s, c, 5);
+    putBits(s, dist - distBase[c], distBits[c]);
+    for (k = 0; k < MATCH_LEN; k ++, n ++) {
+      p[n] = *(p + n - dist);
+    }
+  }
+  putCode(s, 0, 7);       // end of block
+  s->crc = lib_inflate_crc32_update(s->crc, p, n);
+  s->iTotal += n;
+  memmove(s->hist, s->hist + n, LIB_INFLATE_WINDOW_SIZE);
+}
+
+static unsigned int synthRead(void *pCtx, const U1 **ppData)
+{
+  synth *s = (synth *)pCtx;
+  double t = now();
+  s->iOut = 0;
+  if (s->state == 0) {
+    memcpy(s->out, "\x1f\x8b\x08\0\0\0\0\0\0\x03", 10);
+    s->iOut = 10;
+    s->state = 1;
+  }
+  else if (s->state == 1) {
+    int last = (s->iTotal + ROUND_OUT >= s->iTarget);
+    synthRound(s, last);
+    if (last) {
+      alignBits(s);
+      putBits(s, s->crc, 32);
+      putBits(s, (unsigned int)s->iTotal, 32);
+      s->state = 2;
+    }
+  }
+  if (s->f && s->iOut) {
+    fwrite(s->out, 1, s->iOut, s->f);
+  }
+  *ppData = s->out;
+  s->tSynth += now() - t;
+  return s->iOut;
+}
+
+static void gbWrite(void *pCtx, const U1 *pData, U4 len)
+{
+  synth *s = (synth *)pCtx;
+  UNUSED(pData);
+  s->iWritten += len;
+  if (s->iWritten >= s->iNextGb) {
+    double t = now(), tSynth = s->tSynth;
+    printf("  GB %llu: %.0fMB/s\n", s->iNextGb / GB,
+      GB / ((t - s->tGb) - (tSynth - s->tSynthGb)) / 1e6);
+    s->tGb = t;
+    s->tSynthGb = tSynth;
+    s->iNextGb += GB;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  static unsigned char window[LIB_INFLATE_WINDOW_SIZE];
+  unsigned long long iLen = 0;
+  synth *s = (synth *)calloc(1, sizeof(synth));
+  double t;
+  int res;
+  if (!s) {
+    printf("Out of memory\n");
+    return 1;
+  }
+  s->iTarget = (unsigned long long)(((argc > 1) ? atof(argv[1]) : 5) * GB);
+  s->seed = 0x12345678;
+  s->iNextGb = GB;
+  if (argc > 2) {
+    s->f = fopen(argv[2], "wb");
+    if (!s->f) {
+      printf("Can't create %s\n", argv[2]);
+      return 1;
+    }
+  }
+
+  // decompress while synthesising, without the time spent synthesising
+  printf("Stream of %.2fGB through the window\n", (double)s->iTarget / GB);
+  s->tGb = t = now();
+  res = lib_inflate_gzip_uncompress_stream64(synthRead, gbWrite, s, window, &iLen);
+  t = now() - t - s->tSynth;
+  printf("Stream %d uncompressed %lluB of %lluB trailer size %uB CRC32 %08x in %.1fs = %.0fMB/s%s\n", res,
+    iLen, s->iTotal, (unsigned int)s->iTotal, s->crc, t, iLen / t / 1e6,
+    ((res == LIB_INFLATE_SUCCESS) && (iLen == s->iTotal)) ? "" : " FAILED");
+  if (!s->f) {
+    return ((res == LIB_INFLATE_SUCCESS) && (iLen == s->iTotal)) ? 0 : 1;
+  }
+  fclose(s->f);
+
+#if LIB_INFLATE_THREADS > 0
+  {
+    unsigned char *pPool = (unsigned char *)malloc(LIB_INFLATE_READAHEAD_MAX * LIB_INFLATE_READAHEAD_BLOCK);
+    int in = open(argv[2], O_RDONLY);
+    if (!pPool || (in < 0)) {
+      printf("Can't read %s\n", argv[2]);
+      return 1;
+    }
+    iLen = 0;
+    t = now();
+    res = lib_inflate_gzip_uncompress_file64(in, NULL, NULL, window, pPool, 4, 1, &iLen);
+    t = now() - t;
+    close(in);
+    printf("Mapped file %d uncompressed %lluB in %.1fs = %.0fMB/s%s\n", res, iLen, t, iLen / t / 1e6,
+      ((res == LIB_INFLATE_SUCCESS) && (iLen == s->iTotal)) ? "" : " FAILED");
+    free(pPool);
+  }
+#endif
+  return ((res == LIB_INFLATE_SUCCESS) && (iLen == s->iTotal)) ? 0 : 1;
+}
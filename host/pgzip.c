@@ -0,0 +1,400 @@
+//
+// Parallel gzip compressor
+//
+// The input is split into chunks that are compressed concurrently with
+// zlib. Each chunk is primed with the last 32 KB of the chunk before as
+// dictionary, so the ratio stays close to a single stream, and ends byte
+// aligned with a sync flush. The chunks are joined into one gzip member,
+// its CRC32 is combined from the CRC32 of the chunks.
+//
+// With -b the chunks are independent BGZF members instead, without a
+// dictionary and with their size in the header as block table, so they
+// can be decompressed in parallel with lib_inflate_bgzf_index and
+// lib_inflate_bgzf_uncompress.
+//
+// Reading, compressing and writing overlap: the main thread reads chunks
+// into a ring, a pool of workers that lives for the whole run compresses
+// them in any order and a writer thread writes them out in order of their
+// sequence number. A slot of the ring is reused once its chunk is written.
+//
+// build and run on a host with zlib and pthreads using
+// gcc -O2 -I.. pgzip.c ../lib_inflate.c -lz -lpthread -o pgzip
+// ./pgzip [-p threads] [-c chunk kB] [-l level] [-b] [-v] in [out.gz]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <zlib.h>
+#include "lib_inflate.h"
+
+#ifndef LIB_INFLATE_CRC_ENABLED
+#error "pgzip needs LIB_INFLATE_CRC_ENABLED for lib_inflate_crc32_combine"
+#endif
+
+#define DICT_SIZE     32768
+#define RING          4      // chunks in flight per thread
+#define BGZF_CHUNK    65280  // uncompressed bytes per BGZF block, as bgzip
+#define BGZF_HEADER   18
+#define BGZF_TRAILER  8
+#define BGZF_MAX      65536
+
+typedef struct {
+  unsigned char *pIn;        // chunk, its dictionary is right before it
+  unsigned int iLen;
+  unsigned int iDict;
+  int last;                  // ends the gzip member
+  unsigned char *pOut;
+  unsigned int iOut;
+  unsigned int crc;
+  int res;
+  int ready;                 // compressed, waits to be written
+} chunk;
+
+typedef struct {
+  chunk *pChunks;            // ring of slots, chunk n is in slot n % slots
+  unsigned int slots;
+  unsigned long long filled; // chunks read
+  unsigned long long next;   // next chunk to compress
+  unsigned long long written;// chunks written
+  int eof;                   // no more chunks will be read
+  int failed;                // writing failed, the pipeline stops
+  int level;
+  int bgzf;
+  FILE *out;
+  // totals of the written chunks
+  unsigned int crc;
+  unsigned int iTotal;
+  unsigned long long iOutTotal;
+  int res;
+  pthread_mutex_t lock;
+  pthread_cond_t readCond;   // a chunk was read
+  pthread_cond_t doneCond;   // a chunk was compressed
+  pthread_cond_t freeCond;   // a slot was written and is free
+} ring;
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void putU4(unsigned char *p, unsigned int v)
+{
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+// raw deflate of a chunk, ends with Z_FINISH or byte aligned with Z_SYNC_FLUSH
+static int deflateChunk(const chunk *c, int level, int flush, unsigned char *pOut, unsigned int iSize, unsigned int *pLen)
+{
+  z_stream s;
+  int res;
+  memset(&s, 0, sizeof(s));
+  if (deflateInit2(&s, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return -1;
+  }
+  if (c->iDict) {
+    deflateSetDictionary(&s, c->pIn - c->iDict, c->iDict);
+  }
+  s.next_in = (Bytef *)c->pIn;
+  s.avail_in = c->iLen;
+  s.next_out = pOut;
+  s.avail_out = iSize;
+  res = deflate(&s, flush);
+  *pLen = iSize - s.avail_out;
+  deflateEnd(&s);
+  if (flush == Z_FINISH) {
+    return (res == Z_STREAM_END) ? 0 : -1;
+  }
+  return ((res == Z_OK) && s.avail_out && !s.avail_in) ? 0 : -1;
+}
+
+static void compressChunk(chunk *c, int level, int bgzf, unsigned int iSize)
+{
+  unsigned int len;
+  c->crc = lib_inflate_crc32_update(0, c->pIn, c->iLen);
+  if (!bgzf) {
+    c->res = deflateChunk(c, level, c->last ? Z_FINISH : Z_SYNC_FLUSH, c->pOut, iSize, &c->iOut);
+    return;
+  }
+  // a BGZF block is at most 64 kB, store incompressible data
+  c->res = deflateChunk(c, level, Z_FINISH, c->pOut + BGZF_HEADER, iSize - BGZF_HEADER - BGZF_TRAILER, &len);
+  if ((c->res != 0) || (BGZF_HEADER + len + BGZF_TRAILER > BGZF_MAX)) {
+    c->res = deflateChunk(c, 0, Z_FINISH, c->pOut + BGZF_HEADER, iSize - BGZF_HEADER - BGZF_TRAILER, &len);
+  }
+  c->iOut = BGZF_HEADER + len + BGZF_TRAILER;
+  memcpy(c->pOut, "\x1f\x8b\x08\x04\0\0\0\0\0\xff\x06\0BC\x02\0", 16);
+  c->pOut[16] = (c->iOut - 1);
+  c->pOut[17] = (c->iOut - 1) >> 8;
+  putU4(c->pOut + BGZF_HEADER + len, c->crc);
+  putU4(c->pOut + BGZF_HEADER + len + 4, c->iLen);
+}
+
+static unsigned int outSize(unsigned int iChunk)
+{
+  return compressBound(iChunk) + 64 + BGZF_HEADER + BGZF_TRAILER;
+}
+
+static void *worker(void *arg)
+{
+  ring *r = (ring *)arg;
+  for (;;) {
+    chunk *c;
+    pthread_mutex_lock(&r->lock);
+    while ((r->next == r->filled) && !r->eof) {
+      pthread_cond_wait(&r->readCond, &r->lock);
+    }
+    if (r->next == r->filled) {
+      pthread_mutex_unlock(&r->lock);
+      break;
+    }
+    c = &r->pChunks[r->next ++ % r->slots];
+    pthread_mutex_unlock(&r->lock);
+    compressChunk(c, r->level, r->bgzf, outSize(c->iLen));
+    pthread_mutex_lock(&r->lock);
+    c->ready = 1;
+    pthread_cond_signal(&r->doneCond);
+    pthread_mutex_unlock(&r->lock);
+  }
+  return 0;
+}
+
+// writes the chunks in order as they are compressed
+static void *writer(void *arg)
+{
+  ring *r = (ring *)arg;
+  for (;;) {
+    chunk *c;
+    pthread_mutex_lock(&r->lock);
+    c = &r->pChunks[r->written % r->slots];
+    while (((r->written == r->filled) || !c->ready) && !(r->eof && (r->written == r->filled))) {
+      pthread_cond_wait(&r->doneCond, &r->lock);
+    }
+    pthread_mutex_unlock(&r->lock);
+    if (!c->ready) {
+      break;
+    }
+    if (c->res != 0) {
+      r->res = -1;
+    }
+    if (!r->bgzf || c->iLen) {  // an empty BGZF chunk is left to the EOF block
+      if (fwrite(c->pOut, 1, c->iOut, r->out) != c->iOut) {
+        // stop the reader, the workers finish the chunks already read
+        pthread_mutex_lock(&r->lock);
+        r->failed = 1;
+        pthread_cond_signal(&r->freeCond);
+        pthread_mutex_unlock(&r->lock);
+        break;
+      }
+      r->crc = lib_inflate_crc32_combine(r->crc, c->crc, c->iLen);
+      r->iTotal += c->iLen;
+      r->iOutTotal += c->iOut;
+    }
+    pthread_mutex_lock(&r->lock);
+    c->ready = 0;
+    r->written ++;
+    pthread_cond_signal(&r->freeCond);
+    pthread_mutex_unlock(&r->lock);
+  }
+  return 0;
+}
+
+// read up to len bytes, returns the number read
+static unsigned int readFull(FILE *f, unsigned char *p, unsigned int len)
+{
+  unsigned int n = 0;
+  while (n < len) {
+    size_t r = fread(p + n, 1, len - n, f);
+    if (r == 0) {
+      break;
+    }
+    n += r;
+  }
+  return n;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned int threads = sysconf(_SC_NPROCESSORS_ONLN), iChunk = 128 * 1024, i;
+  unsigned long long iIn = 0;
+  int bgzf = 0, verbose = 0, arg = 1, last = 0, res = 0, level = 6, failed = 0;
+  unsigned char *pBuf, *pOut;
+  pthread_t *pThreads, writeThread;
+  chunk *prev = NULL;
+  FILE *in, *out;
+  ring r;
+  double t;
+  for (; (arg < argc) && (argv[arg][0] == '-') && argv[arg][1]; arg ++) {
+    if (!strcmp(argv[arg], "-p") && (arg + 1 < argc)) {
+      threads = atoi(argv[++ arg]);
+    }
+    else if (!strcmp(argv[arg], "-c") && (arg + 1 < argc)) {
+      iChunk = atoi(argv[++ arg]) * 1024;
+    }
+    else if (!strcmp(argv[arg], "-l") && (arg + 1 < argc)) {
+      level = atoi(argv[++ arg]);
+    }
+    else if (!strcmp(argv[arg], "-b")) {
+      bgzf = 1;
+    }
+    else if (!strcmp(argv[arg], "-v")) {
+      verbose = 1;
+    }
+    else {
+      break;
+    }
+  }
+  if (arg >= argc) {
+    printf("usage: pgzip [-p threads] [-c chunk kB] [-l level] [-b] [-v] in [out.gz]\n");
+    return 1;
+  }
+  if (threads < 1) {
+    threads = 1;
+  }
+  if (bgzf) {
+    iChunk = BGZF_CHUNK;
+  }
+  else if (iChunk < DICT_SIZE) {
+    iChunk = DICT_SIZE;
+  }
+  in = strcmp(argv[arg], "-") ? fopen(argv[arg], "rb") : stdin;
+  out = (arg + 1 < argc) ? fopen(argv[arg + 1], "wb") : stdout;
+  if (!in || !out) {
+    fprintf(stderr, "Can't open %s\n", !in ? argv[arg] : argv[arg + 1]);
+    return 1;
+  }
+
+  // each slot has room for the dictionary in front of its chunk
+  memset(&r, 0, sizeof(r));
+  r.slots = threads * RING;
+  r.level = level;
+  r.bgzf = bgzf;
+  r.out = out;
+  pBuf = (unsigned char *)malloc((size_t)r.slots * (DICT_SIZE + iChunk));
+  pOut = (unsigned char *)malloc((size_t)r.slots * outSize(iChunk));
+  r.pChunks = (chunk *)calloc(r.slots, sizeof(*r.pChunks));
+  pThreads = (pthread_t *)malloc(threads * sizeof(*pThreads));
+  if (!pBuf || !pOut || !r.pChunks || !pThreads) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+  for (i = 0; i < r.slots; i ++) {
+    r.pChunks[i].pIn = pBuf + (size_t)i * (DICT_SIZE + iChunk) + DICT_SIZE;
+    r.pChunks[i].pOut = pOut + (size_t)i * outSize(iChunk);
+  }
+  if (!bgzf) {
+    failed = (fwrite("\x1f\x8b\x08\0\0\0\0\0\0\x03", 1, 10, out) != 10);
+    r.iOutTotal += 10;
+  }
+  pthread_mutex_init(&r.lock, NULL);
+  pthread_cond_init(&r.readCond, NULL);
+  pthread_cond_init(&r.doneCond, NULL);
+  pthread_cond_init(&r.freeCond, NULL);
+  t = now();
+  for (i = 0; i < threads; i ++) {
+    pthread_create(&pThreads[i], NULL, worker, &r);
+  }
+  pthread_create(&writeThread, NULL, writer, &r);
+
+  // read chunks into free slots, there is at least one chunk
+  while (!last && !failed) {
+    chunk *ch;
+    int c;
+    pthread_mutex_lock(&r.lock);
+    while ((r.filled - r.written == r.slots) && !r.failed) {
+      pthread_cond_wait(&r.freeCond, &r.lock);
+    }
+    failed = r.failed;
+    ch = &r.pChunks[r.filled % r.slots];
+    pthread_mutex_unlock(&r.lock);
+    if (failed) {
+      break;
+    }
+    ch->iLen = readFull(in, ch->pIn, iChunk);
+    c = getc(in);
+    if (ferror(in)) {
+      fprintf(stderr, "Can't read %s\n", argv[arg]);
+      res = -1;
+      last = 1;
+    }
+    else if (c == EOF) {
+      last = 1;
+    }
+    else {
+      ungetc(c, in);
+    }
+    // the slot of the chunk before is only reused after this one is read
+    ch->iDict = 0;
+    if (!bgzf && prev) {
+      ch->iDict = (prev->iLen < DICT_SIZE) ? prev->iLen : DICT_SIZE;
+      memcpy(ch->pIn - ch->iDict, prev->pIn + prev->iLen - ch->iDict, ch->iDict);
+    }
+    ch->last = last;
+    iIn += ch->iLen;
+    prev = ch;
+    pthread_mutex_lock(&r.lock);
+    r.filled ++;
+    r.eof = last;
+    pthread_cond_broadcast(&r.readCond);
+    pthread_cond_signal(&r.doneCond);
+    pthread_mutex_unlock(&r.lock);
+  }
+  // no more chunks, also when the header or a chunk could not be written
+  pthread_mutex_lock(&r.lock);
+  r.eof = 1;
+  r.failed |= failed;
+  pthread_cond_broadcast(&r.readCond);
+  pthread_cond_signal(&r.doneCond);
+  pthread_mutex_unlock(&r.lock);
+  for (i = 0; i < threads; i ++) {
+    pthread_join(pThreads[i], NULL);
+  }
+  pthread_join(writeThread, NULL);
+  failed = r.failed;
+  if (r.res) {
+    res = -1;
+  }
+  if (!failed && bgzf) {
+    // empty block that marks the end of a BGZF file
+    failed = (fwrite("\x1f\x8b\x08\x04\0\0\0\0\0\xff\x06\0BC\x02\0\x1b\0\x03\0\0\0\0\0\0\0\0\0", 1, 28, out) != 28);
+    r.iOutTotal += 28;
+  }
+  else if (!failed) {
+    unsigned char trailer[8];
+    putU4(trailer, r.crc);
+    putU4(trailer + 4, r.iTotal);
+    failed = (fwrite(trailer, 1, 8, out) != 8);
+    r.iOutTotal += 8;
+  }
+  if (in != stdin) {
+    fclose(in);
+  }
+  // buffered data may only fail to go out when the output is flushed
+  if ((out != stdout) ? fclose(out) : (fflush(out) || ferror(out))) {
+    failed = 1;
+  }
+  t = now() - t;
+  if (failed) {
+    fprintf(stderr, "Can't write %s\n", (arg + 1 < argc) ? argv[arg + 1] : "stdout");
+    res = -1;
+  }
+  else if (verbose) {
+    fprintf(stderr, "%s %d threads %u chunk %ukB uncompressed %lluB compressed %lluB in %.1fms = %.0fMB/s\n",
+      bgzf ? "BGZF" : "gzip", res, threads, iChunk / 1024, iIn, r.iOutTotal, t * 1e3, iIn / t / 1e6);
+  }
+  pthread_mutex_destroy(&r.lock);
+  pthread_cond_destroy(&r.readCond);
+  pthread_cond_destroy(&r.doneCond);
+  pthread_cond_destroy(&r.freeCond);
+  free(pThreads);
+  free(r.pChunks);
+  free(pOut);
+  free(pBuf);
+  return res ? 1 : 0;
+}
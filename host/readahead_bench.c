@@ -0,0 +1,168 @@
+//
+// Read-ahead input stage benchmark
+//
+// The compressed file is fed through a pipe by a writer thread throttled
+// to a given rate, like a slow disk or network. Reading everything before
+// decompressing takes the sum of the I/O and the decode time, with the
+// read-ahead stage the two overlap and the total approaches the larger one.
+//
+// build and run on a host with pthreads using
+// gcc -O2 -DLIB_INFLATE_THREADS=4 -I.. readahead_bench.c ../lib_inflate.c ../lib_inflate_readahead.c -lpthread -o readahead_bench
+// ./readahead_bench file.gz [MB/s] [depth]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include "lib_inflate.h"
+
+#define WRITE_CHUNK 16384
+
+typedef struct {
+  const unsigned char *pData;
+  unsigned int iSize;
+  double rate; // bytes per second
+  int fd;
+} feeder;
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// write the file into the pipe at the given rate
+static void *feed(void *arg)
+{
+  feeder *f = (feeder *)arg;
+  double start = now();
+  unsigned int pos = 0;
+  while (pos < f->iSize) {
+    unsigned int n = (f->iSize - pos < WRITE_CHUNK) ? f->iSize - pos : WRITE_CHUNK;
+    double wait = start + (pos + n) / f->rate - now();
+    if (wait > 0) {
+      struct timespec ts = { (time_t)wait, (long)((wait - (time_t)wait) * 1e9) };
+      nanosleep(&ts, NULL);
+    }
+    if (write(f->fd, f->pData + pos, n) != (ssize_t)n) {
+      break;
+    }
+    pos += n;
+  }
+  close(f->fd);
+  return 0;
+}
+
+static int startFeed(feeder *f, pthread_t *thread)
+{
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return -1;
+  }
+  f->fd = fds[1];
+  pthread_create(thread, NULL, feed, f);
+  return fds[0];
+}
+
+// memory input for timing the decoder alone
+typedef struct {
+  const unsigned char *pData;
+  unsigned int iSize;
+} memory;
+
+static unsigned int memRead(void *pCtx, const U1 **ppData)
+{
+  memory *m = (memory *)pCtx;
+  unsigned int n = m->iSize;
+  *ppData = m->pData;
+  m->iSize = 0;
+  return n;
+}
+
+int main(int argc, char *argv[])
+{
+  static unsigned char window[LIB_INFLATE_WINDOW_SIZE];
+  FILE *f = (argc > 1) ? fopen(argv[1], "rb") : NULL;
+  double rate = ((argc > 2) ? atof(argv[2]) : 10) * 1e6;
+  unsigned int depth = (argc > 3) ? atoi(argv[3]) : 4;
+  unsigned char *pCompressed, *pPool, *pRead;
+  unsigned int iCompressedSize, len, n;
+  double t, tIo, tDecode, tTotal;
+  pthread_t thread;
+  memory mem;
+  feeder fd;
+  int res, in;
+  if (!f) {
+    printf("usage: readahead_bench file.gz [MB/s] [depth]\n");
+    return 1;
+  }
+  fseek(f, 0, SEEK_END);
+  iCompressedSize = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  pCompressed = (unsigned char *)malloc(iCompressedSize);
+  pRead = (unsigned char *)malloc(iCompressedSize);
+  pPool = (unsigned char *)malloc(LIB_INFLATE_READAHEAD_MAX * LIB_INFLATE_READAHEAD_BLOCK);
+  if (!pCompressed || !pRead || !pPool || fread(pCompressed, 1, iCompressedSize, f) != iCompressedSize) {
+    printf("Can't read %s\n", argv[1]);
+    return 1;
+  }
+  fclose(f);
+  fd.pData = pCompressed;
+  fd.iSize = iCompressedSize;
+  fd.rate = rate;
+
+  // decoder alone
+  mem.pData = pCompressed;
+  mem.iSize = iCompressedSize;
+  t = now();
+  res = lib_inflate_gzip_uncompress_stream(memRead, NULL, &mem, window, &len);
+  tDecode = now() - t;
+  printf("Decode from memory %d uncompressed %uB in %.1fms\n", res, len, tDecode * 1e3);
+
+  // read everything, then decode
+  in = startFeed(&fd, &thread);
+  t = now();
+  for (n = 0; n < iCompressedSize; ) {
+    ssize_t r = read(in, pRead + n, iCompressedSize - n);
+    if (r <= 0) {
+      break;
+    }
+    n += r;
+  }
+  tIo = now() - t;
+  mem.pData = pRead;
+  mem.iSize = n;
+  res = lib_inflate_gzip_uncompress_stream(memRead, NULL, &mem, window, &len);
+  tTotal = now() - t;
+  pthread_join(thread, NULL);
+  close(in);
+  printf("Read then decode %d at %.1fMB/s: I/O %.1fms + decode = %.1fms\n", res, rate / 1e6, tIo * 1e3, tTotal * 1e3);
+
+  // read-ahead stage on the pipe
+  in = startFeed(&fd, &thread);
+  t = now();
+  res = lib_inflate_gzip_uncompress_file(in, NULL, NULL, window, pPool, depth, 0, &len);
+  tTotal = now() - t;
+  pthread_join(thread, NULL);
+  close(in);
+  printf("Read-ahead depth %u %d: %.1fms, max(I/O, decode) %.1fms\n", depth, res, tTotal * 1e3,
+    ((tIo > tDecode) ? tIo : tDecode) * 1e3);
+
+  // regular file, mapped and read
+  in = open(argv[1], O_RDONLY);
+  t = now();
+  res = lib_inflate_gzip_uncompress_file(in, NULL, NULL, window, pPool, depth, 1, &len);
+  tTotal = now() - t;
+  printf("Regular file mapped %d: %.1fms\n", res, tTotal * 1e3);
+  lseek(in, 0, SEEK_SET);
+  t = now();
+  res = lib_inflate_gzip_uncompress_file(in, NULL, NULL, window, pPool, depth, 0, &len);
+  tTotal = now() - t;
+  printf("Regular file read-ahead %d: %.1fms\n", res, tTotal * 1e3);
+  close(in);
+  return 0;
+}
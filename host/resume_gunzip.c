@@ -0,0 +1,154 @@
+//
+// Resumable gunzip over a simulated flaky link
+//
+// The compressed file is "downloaded" in random pieces and the link drops
+// at random points. After each drop the decoder is restored from the last
+// snapshot, the output is cut back to the snapshot and the download is
+// resumed from the compressed offset of the snapshot. The result is
+// compared with a single uninterrupted run.
+//
+// build and run on a host using
+// gcc -O2 -I.. resume_gunzip.c ../lib_inflate.c -o resume_gunzip
+// ./resume_gunzip file.gz [drops] [seed]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lib_inflate.h"
+
+#define MAX_PIECE 4096
+
+typedef struct {
+  const unsigned char *pCompressed;
+  unsigned int iCompressedSize;
+  unsigned int iOffset;     // next byte of the download
+  unsigned int iDropAt;     // offset where the link drops, or iCompressedSize
+  unsigned char *pOutput;   // everything written so far
+  unsigned int iOutput;
+  unsigned int iOutputSize; // size of pOutput, grows as needed
+  int outOfMemory;
+  unsigned char *pSaved;    // last snapshot as it would be persisted to flash
+  unsigned int iSaved;
+  unsigned int iSnapshots;
+} link_ctx;
+
+static unsigned int linkRead(void *pCtx, const U1 **ppData)
+{
+  link_ctx *ctx = (link_ctx *)pCtx;
+  unsigned int n = 1 + rand() % MAX_PIECE;
+  if (ctx->iOffset + n > ctx->iDropAt) {
+    n = ctx->iDropAt - ctx->iOffset;
+  }
+  *ppData = ctx->pCompressed + ctx->iOffset;
+  ctx->iOffset += n;
+  return n;
+}
+
+static void linkWrite(void *pCtx, const U1 *pData, U4 len)
+{
+  link_ctx *ctx = (link_ctx *)pCtx;
+  // the trailer only has the size of the last member, so grow the output
+  if (ctx->iOutput + len > ctx->iOutputSize) {
+    unsigned int size = 2 * ctx->iOutputSize + len;
+    unsigned char *p = (unsigned char *)realloc(ctx->pOutput, size);
+    if (!p) {
+      ctx->outOfMemory = 1;
+      return;
+    }
+    ctx->pOutput = p;
+    ctx->iOutputSize = size;
+  }
+  memcpy(ctx->pOutput + ctx->iOutput, pData, len);
+  ctx->iOutput += len;
+}
+
+static void linkSave(void *pCtx, const U1 *pState, U4 len)
+{
+  link_ctx *ctx = (link_ctx *)pCtx;
+  memcpy(ctx->pSaved, pState, len);
+  ctx->iSaved = len;
+  ctx->iSnapshots ++;
+}
+
+int main(int argc, char *argv[])
+{
+  static unsigned char window[LIB_INFLATE_WINDOW_SIZE];
+  static unsigned char state[LIB_INFLATE_STATE_SIZE];
+  static unsigned char saved[LIB_INFLATE_STATE_SIZE];
+  FILE *f = (argc > 1) ? fopen(argv[1], "rb") : NULL;
+  int drops = (argc > 2) ? atoi(argv[2]) : 10;
+  unsigned char *pCompressed, *pReference;
+  unsigned int iCompressedSize, iUncompressedSize, iReference, iResent = 0, resumes = 0;
+  unsigned int len = 0, stateLen = 0;
+  link_ctx ctx;
+  int res, differ;
+  if (!f) {
+    printf("usage: resume_gunzip file.gz [drops] [seed]\n");
+    return 1;
+  }
+  srand((argc > 3) ? atoi(argv[3]) : 1);
+  fseek(f, 0, SEEK_END);
+  iCompressedSize = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  pCompressed = (unsigned char *)malloc(iCompressedSize);
+  if (!pCompressed || fread(pCompressed, 1, iCompressedSize, f) != iCompressedSize) {
+    printf("Can't read %s\n", argv[1]);
+    return 1;
+  }
+  fclose(f);
+  // only a hint, the trailer has the size of the last member
+  iUncompressedSize = lib_inflate_gzip_size(pCompressed, iCompressedSize);
+
+  // reference run without drops
+  memset(&ctx, 0, sizeof(ctx));
+  ctx.pCompressed = pCompressed;
+  ctx.iCompressedSize = iCompressedSize;
+  ctx.iDropAt = iCompressedSize;
+  ctx.pSaved = saved;
+  ctx.iOutputSize = iUncompressedSize + LIB_INFLATE_WINDOW_SIZE;
+  ctx.pOutput = (unsigned char *)malloc(ctx.iOutputSize);
+  res = lib_inflate_gzip_uncompress_resume(linkRead, linkWrite, NULL, &ctx, window, state, 0, &len);
+  pReference = ctx.pOutput;
+  iReference = ctx.iOutput;
+  printf("Reference %d compressed %uB uncompressed %uB\n", res, iCompressedSize, iReference);
+  if (!ctx.pOutput || ctx.outOfMemory) {
+    printf("Out of memory\n");
+    return 1;
+  }
+
+  // interrupted run
+  memset(&ctx, 0, sizeof(ctx));
+  ctx.pCompressed = pCompressed;
+  ctx.iCompressedSize = iCompressedSize;
+  ctx.pSaved = saved;
+  ctx.iOutputSize = iUncompressedSize + LIB_INFLATE_WINDOW_SIZE;
+  ctx.pOutput = (unsigned char *)malloc(ctx.iOutputSize);
+  for (;;) {
+    unsigned long long srcOffset = 0, destOffset = 0;
+    ctx.iDropAt = (drops > 0) ? ctx.iOffset + rand() % (iCompressedSize - ctx.iOffset + 1) : iCompressedSize;
+    res = lib_inflate_gzip_uncompress_resume(linkRead, linkWrite, linkSave, &ctx, window, state, stateLen, &len);
+    if ((res == LIB_INFLATE_SUCCESS) || (drops <= 0)) {
+      break;
+    }
+    // the link dropped, continue from the last snapshot
+    drops --;
+    resumes ++;
+    stateLen = ctx.iSaved;
+    memcpy(state, saved, stateLen);
+    if (stateLen && !lib_inflate_state_offsets(state, stateLen, &srcOffset, &destOffset)) {
+      printf("Bad snapshot\n");
+      return 1;
+    }
+    iResent += ctx.iOffset - srcOffset;
+    ctx.iOffset = srcOffset;
+    ctx.iOutput = destOffset;
+  }
+  differ = ctx.outOfMemory || (ctx.iOutput != iReference) || memcmp(ctx.pOutput, pReference, iReference);
+  printf("Resumed %u times %d=%s uncompressed %uB snapshots %u re-sent %uB output %s\n",
+    resumes, res, (res == LIB_INFLATE_SUCCESS) ? "OK" : "ERR", ctx.iOutput, ctx.iSnapshots, iResent,
+    differ ? "DIFFERENT" : "identical");
+  free(ctx.pOutput);
+  free(pReference);
+  free(pCompressed);
+  return (res != LIB_INFLATE_SUCCESS) || differ;
+}
@@ -0,0 +1,127 @@
+//
+// Huffman lookup table benchmark
+//
+// Times the inflate step alone, without the gzip CRC, for text and binary
+// corpora. Build it once decoding bit by bit and once with lookup tables,
+// text gains most as its short literal codes come in pairs. With tables
+// each file is also timed always decoding bit by bit, always building the
+// tables and with the per block heuristics, for tuning them on small blocks
+//
+// build and run on a host using
+// gcc -O2 -DLIB_INFLATE_TABLE_BITS=0 -I.. table_bench.c ../lib_inflate.c -o table_bench_0
+// gcc -O2 -DLIB_INFLATE_TABLE_BITS=10 -I.. table_bench.c ../lib_inflate.c -o table_bench_10
+// ./table_bench_10 text.gz binary.gz
+// ./table_bench_10 -s 1024 10 small_blocks.gz   (adaptive minSymbols minCodeLen)
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lib_inflate.h"
+
+#define RUNS 10
+
+#if LIB_INFLATE_TABLE_BITS > 0
+static struct {
+  const char *name;
+  lib_inflate_strategy strategy;
+} strategies[] = {
+  { "walk",     { 0xFFFFFFFF, 0 } },
+  { "tables",   { 0, 0 } },
+  { "adaptive", { 1 << LIB_INFLATE_TABLE_BITS, 10 } },
+};
+#define STRATEGIES (sizeof(strategies) / sizeof(strategies[0]))
+#endif
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// offset of the deflate data after the gzip header
+static unsigned int gzipHeader(const unsigned char *p, unsigned int len)
+{
+  unsigned int pos = 10;
+  if (p[3] & 4) {
+    pos += 2 + (p[10] | (p[11] << 8));
+  }
+  if (p[3] & 8) {
+    while ((pos < len) && p[pos++]);
+  }
+  if (p[3] & 16) {
+    while ((pos < len) && p[pos++]);
+  }
+  if (p[3] & 2) {
+    pos += 2;
+  }
+  return pos;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned int s, numStrategies = 1;
+  int i = 1, n;
+#if LIB_INFLATE_TABLE_BITS > 0
+  if ((argc > 3) && !strcmp(argv[1], "-s")) {
+    strategies[STRATEGIES - 1].strategy.minSymbols = strtoul(argv[2], NULL, 0);
+    strategies[STRATEGIES - 1].strategy.minCodeLen = strtoul(argv[3], NULL, 0);
+    i = 4;
+  }
+#endif
+  if (argc <= i) {
+    printf("usage: table_bench file.gz ...\n");
+    return 1;
+  }
+#if LIB_INFLATE_TABLE_BITS > 0
+  numStrategies = STRATEGIES;
+#endif
+  printf("Huffman lookup table bits %d\n", LIB_INFLATE_TABLE_BITS);
+  for (; i < argc; i ++) {
+    FILE *f = fopen(argv[i], "rb");
+    unsigned char *pCompressed, *pUncompressed;
+    unsigned int iCompressedSize, iUncompressedSize, start, decSize;
+    double t, best = 1e9;
+    int res = 0;
+    if (!f) {
+      printf("Can't open %s\n", argv[i]);
+      continue;
+    }
+    fseek(f, 0, SEEK_END);
+    iCompressedSize = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    pCompressed = (unsigned char *)malloc(iCompressedSize);
+    if (!pCompressed || fread(pCompressed, 1, iCompressedSize, f) != iCompressedSize || iCompressedSize < 18) {
+      printf("Can't read %s\n", argv[i]);
+      fclose(f);
+      continue;
+    }
+    fclose(f);
+    iUncompressedSize = lib_inflate_gzip_size(pCompressed, iCompressedSize);
+    pUncompressed = (unsigned char *)malloc(iUncompressedSize + 1);
+    start = gzipHeader(pCompressed, iCompressedSize);
+    for (s = 0; s < numStrategies; s ++) {
+      const char *name = "";
+#if LIB_INFLATE_TABLE_BITS > 0
+      lib_inflate_set_strategy(&strategies[s].strategy);
+      name = strategies[s].name;
+#endif
+      best = 1e9;
+      for (n = 0; n < RUNS; n ++) {
+        decSize = iUncompressedSize;
+        t = now();
+        res = lib_inflate_uncompress(pUncompressed, &decSize, pCompressed + start, iCompressedSize - start - 8);
+        t = now() - t;
+        if (t < best) {
+          best = t;
+        }
+      }
+      printf("%-24s %-8s %d compressed %uB uncompressed %uB inflate %.2fms = %.0fMB/s\n", argv[i], name, res,
+        iCompressedSize, decSize, best * 1e3, decSize / best / 1e6);
+    }
+    free(pCompressed);
+    free(pUncompressed);
+  }
+  return 0;
+}
@@ -28,6 +28,23 @@
  
  #include "lib_inflate.h"
 
+#if defined(__GNUC__)
+ // Force the bit reader into each decode loop variant so it is compiled for its target 
+ #define LIB_INFLATE_INLINE static inline __attribute__((always_inline))
+#else
+ #define LIB_INFLATE_INLINE static inline
+#endif
+
+#if LIB_INFLATE_THREADS > 0
+ #include <pthread.h>
+#endif
+
+#if defined(__x86_64__) && defined(__GNUC__)
+ // Runtime selected BMI2 and AVX2 variants of the block decode loop 
+ #define LIB_INFLATE_DISPATCH_X86
+ #include <immintrin.h>
+#endif
+
 typedef enum {
 	FTEXT    = 1,
 	FHCRC    = 2,
@@ -38,12 +55,6 @@ typedef enum {
 
 // -- Iernal data structures -- 
 
-struct lib_inflate_tree {
-	U2 counts[16]; // Number of codes with a given length 
-	U2 symbols[288]; // Symbols sorted by code 
-	I max_sym;
-};
-
 struct lib_inflate_data {
 	const U1 *source;
 	const U1 *source_end;
@@ -55,12 +66,45 @@ struct lib_inflate_data {
 	U1 *dest;
 	U1 *dest_end;
 
+	I bfinal; // Final block flag of the current block 
+	I btype; // Type of the current block, -1 if the next block header is due 
+
+	I window; // Output goes to a circular window from dest_start to dest_end 
+	U8 total; // Bytes flushed out of the window or in the previous segments 
+
+	const lib_inflate_segment *segs; // Output segments, or NULL for a single buffer 
+	U4 num_segs; // Number of output segments 
+	U4 seg; // Segment from dest_start to dest_end 
+
+	I prefix; // Stop with success when the output is full 
+	I stopped; // Stopped at the end of the output before the end of the stream 
+
+	lib_inflate_read_fn read; // Supplies the next piece of input, or NULL 
+	lib_inflate_write_fn write; // Takes the bytes flushed out of the window, or NULL 
+	lib_inflate_save_fn save; // Takes snapshots of the decoder state, or NULL 
+	void *ctx; // Context of the callbacks 
+	const U1 *src_piece; // Start of the current piece of input 
+	U8 src_offset; // Compressed bytes before the current piece 
+
+	U1 *state; // Buffer of LIB_INFLATE_STATE_SIZE bytes for the snapshots 
+	I save_due; // A snapshot is taken at the next symbol or block boundary 
+#ifdef LIB_INFLATE_CRC_ENABLED
+	U4 crc; // CRC32 of the bytes flushed out of the window 
+#endif
+
 	struct lib_inflate_tree ltree; // Literal/length tree 
 	struct lib_inflate_tree dtree; // Distance tree 
+#if LIB_INFLATE_TABLE_BITS > 0
+	I tables; // The lookup tables match the trees of the current block 
+	I tables_fixed; // The lookup tables hold the fixed trees 
+	U4 ltable[1 << LIB_INFLATE_TABLE_BITS]; // Literal/length lookup table 
+	U4 dtable[1 << LIB_INFLATE_TABLE_BITS]; // Distance lookup table 
+#endif
 };
 
 #ifdef LIB_INFLATE_CRC_ENABLED
-static U4 lib_inflate_crc32(const void *data, U4 length)
+// Update a CRC32 with the next `length` bytes of data 
+U4 lib_inflate_crc32_update(U4 crc, const void *data, U4 length)
 {
 	static const U4 crc32tab[16] = {
 		0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190,
@@ -69,11 +113,11 @@ static U4 lib_inflate_crc32(const void *data, U4 length)
 		0xBDBDF21C
 	};
 	const U1 *buf = (const U1 *) data;
-	U4 crc = 0xFFFFFFFF;
 	U4 i;
 	if (length == 0) {
-		return 0;
+		return crc;
 	}
+	crc ^= 0xFFFFFFFF;
 	for (i = 0; i < length; ++i) {
 		crc ^= buf[i];
 		crc = crc32tab[crc & 0x0F] ^ (crc >> 4);
@@ -81,6 +125,122 @@ static U4 lib_inflate_crc32(const void *data, U4 length)
 	}
 	return crc ^ 0xFFFFFFFF;
 }
+
+// Multiply a and b modulo the CRC32 polynomial, in reflected bit order 
+static U4 lib_inflate_crc32_multmodp(U4 a, U4 b)
+{
+	U4 m = 0x80000000;
+	U4 p = 0;
+	for (;;) {
+		if (a & m) {
+			p ^= b;
+			if ((a & (m - 1)) == 0) {
+				break;
+			}
+		}
+		m >>= 1;
+		b = (b & 1) ? (b >> 1) ^ 0xEDB88320 : b >> 1;
+	}
+	return p;
+}
+
+U4 lib_inflate_crc32_combine(U4 crc1, U4 crc2, U4 len2)
+{
+	U4 sq = 0x40000000; // x^1 
+	U4 p = 0x80000000;  // x^0 
+	I i;
+	// Start at x^8 for the shift by one byte 
+	for (i = 0; i < 3; ++i) {
+		sq = lib_inflate_crc32_multmodp(sq, sq);
+	}
+	// Compute x^(8 * len2) by square and multiply 
+	for (; len2; len2 >>= 1) {
+		if (len2 & 1) {
+			p = lib_inflate_crc32_multmodp(sq, p);
+		}
+		sq = lib_inflate_crc32_multmodp(sq, sq);
+	}
+	return lib_inflate_crc32_multmodp(p, crc1) ^ crc2;
+}
+
+#if LIB_INFLATE_THREADS > 0
+struct lib_inflate_crc32_job {
+	const U1 *data;
+	U4 length;
+	U4 crc;
+};
+
+static void *lib_inflate_crc32_worker(void *arg)
+{
+	struct lib_inflate_crc32_job *job = (struct lib_inflate_crc32_job *) arg;
+	job->crc = lib_inflate_crc32_update(0, job->data, job->length);
+	return 0;
+}
+
+U4 lib_inflate_crc32_parallel(const void *data, U4 length, U4 threads)
+{
+	struct lib_inflate_crc32_job job[LIB_INFLATE_THREADS];
+	pthread_t thread[LIB_INFLATE_THREADS];
+	I started[LIB_INFLATE_THREADS];
+	U4 chunk, crc, i;
+
+	// Split into chunks of at least LIB_INFLATE_THREADS_CHUNK bytes 
+	if (threads > LIB_INFLATE_THREADS) {
+		threads = LIB_INFLATE_THREADS;
+	}
+	if (threads > length / LIB_INFLATE_THREADS_CHUNK) {
+		threads = length / LIB_INFLATE_THREADS_CHUNK;
+	}
+	if (threads < 2) {
+		return lib_inflate_crc32_update(0, data, length);
+	}
+	chunk = length / threads;
+	for (i = 0; i < threads; ++i) {
+		job[i].data = (const U1 *) data + i * chunk;
+		job[i].length = (i == threads - 1) ? length - i * chunk : chunk;
+	}
+
+	// The first chunk is done by the calling thread 
+	for (i = 1; i < threads; ++i) {
+		started[i] = (pthread_create(&thread[i], 0, lib_inflate_crc32_worker, &job[i]) == 0);
+	}
+	lib_inflate_crc32_worker(&job[0]);
+	crc = job[0].crc;
+	for (i = 1; i < threads; ++i) {
+		if (started[i]) {
+			pthread_join(thread[i], 0);
+		}
+		else {
+			lib_inflate_crc32_worker(&job[i]);
+		}
+		crc = lib_inflate_crc32_combine(crc, job[i].crc, job[i].length);
+	}
+	return crc;
+}
+#endif
+
+static U4 lib_inflate_crc32(const void *data, U4 length)
+{
+#if LIB_INFLATE_THREADS > 0
+	return lib_inflate_crc32_parallel(data, length, LIB_INFLATE_THREADS);
+#else
+	return lib_inflate_crc32_update(0, data, length);
+#endif
+}
+
+// CRC32 of data that may exceed 4 GB, in pieces of 1 GB 
+static U4 lib_inflate_crc32_long(const void *data, U8 length)
+{
+	const U1 *buf = (const U1 *) data;
+	U4 crc = 0;
+	while (length) {
+		U4 n = (length < (1UL << 30)) ? (U4) length : (1UL << 30);
+		crc = lib_inflate_crc32_combine(crc, lib_crc32(buf, n), n);
+		buf += n;
+		length -= n;
+	}
+	return crc;
+}
 #endif
 
 // Build fixed Huffman trees 
@@ -195,15 +355,175 @@ static lib_inflate_data_error_code lib_inflate_build_tree(
 	return LIB_INFLATE_DATA_SUCCESS;
 }
 
+#if LIB_INFLATE_TABLE_BITS > 0
+// Lookup table entries hold the code bits used, the number of symbols,
+// the first symbol and a second literal right after a first literal, so
+// both can be stored at once, codes longer than the index have no entry
+// and are decoded bit by bit 
+#define LIB_INFLATE_ENTRY(bits, num, sym, lit) ((bits) | ((num) << 4) | ((sym) << 8) | ((U4) (lit) << 16))
+#define LIB_INFLATE_ENTRY_BITS(e) ((e) & 0x0F)
+#define LIB_INFLATE_ENTRY_NUM(e)  (((e) >> 4) & 0x03)
+#define LIB_INFLATE_ENTRY_SYM(e)  (((e) >> 8) & 0x1FF)
+#define LIB_INFLATE_ENTRY_PAIR(e) ((U2) ((e) >> 8))
+#define LIB_INFLATE_TABLE_MASK    ((1 << LIB_INFLATE_TABLE_BITS) - 1)
+
+// Build a lookup table indexed by the next LIB_INFLATE_TABLE_BITS bits of
+// input, with `pairs` an entry also takes a second literal if its code fits 
+static void lib_inflate_build_table(U4 *table, const struct lib_inflate_tree *t, I pairs)
+{
+	const U4 size = 1 << LIB_INFLATE_TABLE_BITS;
+	U4 i, len, k = 0, code = 0;
+
+	for (i = 0; i < size; ++i) {
+		table[i] = 0;
+	}
+
+	// Assign the canonical codes in order, the input holds them bit reversed 
+	for (len = 1; len <= LIB_INFLATE_TABLE_BITS; ++len, code <<= 1) {
+		for (i = 0; i < t->counts[len]; ++i, ++k, ++code) {
+			U4 rev = 0, b, j;
+			for (b = 0; b < len; ++b) {
+				rev |= ((code >> b) & 1) << (len - 1 - b);
+			}
+			for (j = rev; j < size; j += 1 << len) {
+				table[j] = LIB_INFLATE_ENTRY(len, 1, t->symbols[k], 0);
+			}
+		}
+	}
+
+	// Join literals with the literal following in the unused index bits,
+	// downwards as the following literal is looked up at a lower index 
+	if (pairs) {
+		for (i = size; i-- > 0; ) {
+			U4 e = table[i], e2;
+			len = LIB_INFLATE_ENTRY_BITS(e);
+			if (!e || LIB_INFLATE_ENTRY_SYM(e) >= 256 || len == LIB_INFLATE_TABLE_BITS) {
+				continue;
+			}
+			e2 = table[i >> len];
+			if (e2 && LIB_INFLATE_ENTRY_NUM(e2) == 1 && LIB_INFLATE_ENTRY_SYM(e2) < 256
+			 && LIB_INFLATE_ENTRY_BITS(e2) <= LIB_INFLATE_TABLE_BITS - len) {
+				table[i] = LIB_INFLATE_ENTRY(len + LIB_INFLATE_ENTRY_BITS(e2), 2,
+				                             LIB_INFLATE_ENTRY_SYM(e), LIB_INFLATE_ENTRY_SYM(e2));
+			}
+		}
+	}
+}
+
+// Defaults of the per block heuristics, tuned with host/table_bench.c 
+#define LIB_INFLATE_STRATEGY_SYMBOLS  (1 << LIB_INFLATE_TABLE_BITS)
+#define LIB_INFLATE_STRATEGY_CODE_LEN 10
+
+static lib_inflate_strategy lib_inflate_strategy_in_use = {
+	LIB_INFLATE_STRATEGY_SYMBOLS, LIB_INFLATE_STRATEGY_CODE_LEN
+};
+
+void lib_inflate_set_strategy(const lib_inflate_strategy *pStrategy)
+{
+	if (pStrategy) {
+		lib_inflate_strategy_in_use = *pStrategy;
+	}
+	else {
+		lib_inflate_strategy_in_use.minSymbols = LIB_INFLATE_STRATEGY_SYMBOLS;
+		lib_inflate_strategy_in_use.minCodeLen = LIB_INFLATE_STRATEGY_CODE_LEN;
+	}
+}
+#endif
+
 // -- Decode functions -- 
 
-static void lib_inflate_refill(struct lib_inflate_data *d, I num)
+// Account for the bytes in the circular window and restart at its begin 
+static void lib_inflate_window_flush(struct lib_inflate_data *d)
+{
+#ifdef LIB_INFLATE_CRC_ENABLED
+	d->crc = lib_inflate_crc32_update(d->crc, d->dest_start, d->dest - d->dest_start);
+#endif
+	if (d->write) {
+		d->write(d->ctx, d->dest_start, d->dest - d->dest_start);
+	}
+	d->total += d->dest - d->dest_start;
+	d->dest = d->dest_start;
+	d->save_due = (d->save != 0);
+}
+
+// Continue the output in the next non empty segment, returns 0 if there is none 
+static I lib_inflate_segment_next(struct lib_inflate_data *d)
+{
+	while (d->seg + 1 < d->num_segs) {
+		d->total += d->dest - d->dest_start;
+		d->seg++;
+		d->dest_start = (U1 *) d->segs[d->seg].pDest;
+		d->dest = d->dest_start;
+		d->dest_end = d->dest_start + d->segs[d->seg].len;
+		if (d->dest != d->dest_end) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Copy a match whose source or destination crosses a segment boundary,
+// returns 0 or an error code 
+static I lib_inflate_segment_match(struct lib_inflate_data *d, U4 offs, U4 length)
+{
+	U4 s = d->seg;
+	U4 avail = d->dest - d->dest_start;
+	const U1 *from, *from_end;
+
+	// Find the segment holding the start of the match source 
+	while (offs > avail && s > 0) {
+		offs -= avail;
+		avail = d->segs[--s].len;
+	}
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	if (offs > avail) {
+		return LIB_INFLATE_DATA_ERROR;
+	}
+#endif
+	from = (const U1 *) d->segs[s].pDest + avail - offs;
+	from_end = (const U1 *) d->segs[s].pDest + d->segs[s].len;
+
+	// Source and destination each move on to their next segment when they
+	// reach the end of their current one 
+	while (length--) {
+		if (d->dest == d->dest_end && !lib_inflate_segment_next(d)) {
+#ifdef LIB_INFLATE_ERROR_ENABLED
+			return LIB_INFLATE_BUF_ERROR;
+#else
+			break;
+#endif
+		}
+		while (from == from_end) {
+			++s;
+			from = (const U1 *) d->segs[s].pDest;
+			from_end = from + d->segs[s].len;
+		}
+		*d->dest++ = *from++;
+	}
+	return 0;
+}
+
+// Get the next piece of input from the read callback 
+static I lib_inflate_pull(struct lib_inflate_data *d)
+{
+	U4 len;
+	if (!d->read) {
+		return 0;
+	}
+	d->src_offset += d->source_end - d->src_piece;
+	len = d->read(d->ctx, &d->source);
+	d->src_piece = d->source;
+	d->source_end = d->source + len;
+	return len != 0;
+}
+
+LIB_INFLATE_INLINE void lib_inflate_refill(struct lib_inflate_data *d, I num)
 {
 	ASSERT(num >= 0 && num <= 32);
 
 	// Read bytes until at least num bits available 
 	while (d->bitcount < num) {
-		if (d->source != d->source_end) {
+		if (d->source != d->source_end || lib_inflate_pull(d)) {
 			d->tag |= (U4) *d->source++ << d->bitcount;
 		}
 		else {
@@ -215,14 +535,14 @@ static void lib_inflate_refill(struct lib_inflate_data *d, I num)
 	ASSERT(d->bitcount <= 32);
 }
 
-static U4 lib_inflate_getbits_no_refill(struct lib_inflate_data *d, I num)
+LIB_INFLATE_INLINE U4 lib_inflate_getbits_no_refill(struct lib_inflate_data *d, I num)
 {
 	U4 bits;
 
 	ASSERT(num >= 0 && num <= d->bitcount);
 
 	// Get bits from tag 
-	bits = d->tag & ((1UL << num) - 1);
+	bits = d->tag & (((U4) 1 << num) - 1);
 
 	// Remove bits from tag 
 	d->tag >>= num;
@@ -232,20 +552,20 @@ static U4 lib_inflate_getbits_no_refill(struct lib_inflate_data *d, I num)
 }
 
 // Get num bits from source stream 
-static U4 lib_inflate_getbits(struct lib_inflate_data *d, I num)
+LIB_INFLATE_INLINE U4 lib_inflate_getbits(struct lib_inflate_data *d, I num)
 {
 	lib_inflate_refill(d, num);
 	return lib_inflate_getbits_no_refill(d, num);
 }
 
 // Read a num bit value from stream and add base 
-static U4 lib_inflate_getbits_base(struct lib_inflate_data *d, I num, I base)
+LIB_INFLATE_INLINE U4 lib_inflate_getbits_base(struct lib_inflate_data *d, I num, I base)
 {
 	return base + (num ? lib_inflate_getbits(d, num) : 0);
 }
 
 // Given a data stream and a tree, decode a symbol 
-static I lib_inflate_decode_symbol(struct lib_inflate_data *d, const struct lib_inflate_tree *t)
+LIB_INFLATE_INLINE I lib_inflate_decode_symbol(struct lib_inflate_data *d, const struct lib_inflate_tree *t)
 {
 	I base = 0, offs = 0;
 	I len;
@@ -429,405 +749,1666 @@ static lib_inflate_data_error_code lib_inflate_decode_trees(
 #endif
 }
 
-// -- Block inflate functions -- 
-
-// Given a stream and two trees, inflate a block of data 
-static lib_inflate_data_error_code lib_inflate_inflate_block_data(
-																	struct lib_inflate_data *d, 
-																	struct lib_inflate_tree *lt,
-                                  struct lib_inflate_tree *dt)
-{
-	// Extra bits and base tables for length codes 
-	static const U1 length_bits[30] = {
-		0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
-		1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
-		4, 4, 4, 4, 5, 5, 5, 5, 0, 127
-	};
-
-	static const U2 length_base[30] = {
-		 3,  4,  5,   6,   7,   8,   9,  10,  11,  13,
-		15, 17, 19,  23,  27,  31,  35,  43,  51,  59,
-		67, 83, 99, 115, 131, 163, 195, 227, 258,   0
-	};
-
-	// Extra bits and base tables for distance codes 
-	static const U1 dist_bits[30] = {
-		0, 0,  0,  0,  1,  1,  2,  2,  3,  3,
-		4, 4,  5,  5,  6,  6,  7,  7,  8,  8,
-		9, 9, 10, 10, 11, 11, 12, 12, 13, 13
-	};
-
-	static const U2 dist_base[30] = {
-		   1,    2,    3,    4,    5,    7,    9,    13,    17,    25,
-		  33,   49,   65,   97,  129,  193,  257,   385,   513,   769,
-		1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
-	};
-
-	for (;;) {
-		I sym = lib_inflate_decode_symbol(d, lt);
-
-#ifdef LIB_INFLATE_ERROR_ENABLED
-		// Check for overflow in bit reader 
-		if (d->overflow) {
-			return LIB_INFLATE_DATA_ERROR;
-		}
-#endif
-		if (sym < 256) {
-#ifdef LIB_INFLATE_ERROR_ENABLED
-			if (d->dest == d->dest_end) {
-				return LIB_INFLATE_BUF_ERROR;
-			}
-#endif
-			*d->dest++ = sym;
-		}
-		else {
-			I length, dist, offs;
-			I i;
-
-			// Check for end of block 
-			if (sym == 256) {
-				return LIB_INFLATE_DATA_SUCCESS;
-			}
-
-#ifdef LIB_INFLATE_ERROR_ENABLED
-			// Check sym is within range and distance tree is not empty 
-			if (sym > lt->max_sym || sym - 257 > 28 || dt->max_sym == -1) {
-				return LIB_INFLATE_DATA_ERROR;
-			}
-#endif
-			sym -= 257;
+// -- Decoder state snapshots -- 
 
-			// Possibly get more bits from length code 
-			length = lib_inflate_getbits_base(d, length_bits[sym],
-			                           length_base[sym]);
+// Bytes of a snapshot before the window 
+#define LIB_INFLATE_STATE_HEADER 30
 
-			dist = lib_inflate_decode_symbol(d, dt);
+// Store `num` bytes of a value in little endian order 
+static U1 *lib_inflate_state_put(U1 *p, U8 v, I num)
+{
+	for (; num > 0; --num, v >>= 8) {
+		*p++ = (U1) v;
+	}
+	return p;
+}
 
-#ifdef LIB_INFLATE_ERROR_ENABLED
-			// Check dist is within range 
-			if (dist > dt->max_sym || dist > 29) {
-				return LIB_INFLATE_DATA_ERROR;
-			}
-#endif
-			// Possibly get more bits from distance code 
-			offs = lib_inflate_getbits_base(d, dist_bits[dist],
-			                         dist_base[dist]);
+// Load `num` bytes of a value in little endian order 
+static U8 lib_inflate_state_get(const U1 *p, I num)
+{
+	U8 v = 0;
+	while (num--) {
+		v = (v << 8) | p[num];
+	}
+	return v;
+}
 
-#ifdef LIB_INFLATE_ERROR_ENABLED
-			if (offs > d->dest - d->dest_start) {
-				return LIB_INFLATE_DATA_ERROR;
-			}
+// Recover the code lengths of a tree from its symbols sorted by code,
+// returns the number of lengths 
+static U4 lib_inflate_tree_lengths(const struct lib_inflate_tree *t, U1 *lengths)
+{
+	U4 num = t->max_sym + 1;
+	U4 i, len, k = 0;
 
-			if (d->dest_end - d->dest < length) {
-				return LIB_INFLATE_BUF_ERROR;
-			}
-#endif
-			// Copy match 
-			for (i = 0; i < length; ++i) {
-				d->dest[i] = d->dest[i - offs];
+	for (i = 0; i < num; ++i) {
+		lengths[i] = 0;
+	}
+	for (len = 1; len < 16; ++len) {
+		for (i = 0; i < t->counts[len]; ++i, ++k) {
+			// Skip the extra code of a tree with a single code 
+			if (t->symbols[k] < num) {
+				lengths[t->symbols[k]] = len;
 			}
-
-			d->dest += length;
 		}
 	}
+	return num;
 }
 
-// Inflate an uncompressed block of data 
-static lib_inflate_data_error_code lib_inflate_inflate_uncompressed_block(struct lib_inflate_data *d)
+// Serialise the decoder state at a symbol or block boundary and hand it
+// to the save callback 
+static void lib_inflate_state_save(struct lib_inflate_data *d)
 {
-	U4 length;
-#ifdef LIB_INFLATE_ERROR_ENABLED
-	U4 invlength;
-
-	if (d->source_end - d->source < 4) {
-		return LIB_INFLATE_DATA_ERROR;
+	U1 *p = d->state;
+	U4 i, pos = d->dest - d->dest_start;
+	U4 size = (d->total ? d->dest_end - d->dest_start : pos);
+
+	d->save_due = 0;
+	// Input that ran out leaves nothing worth saving 
+	if (d->overflow) {
+		return;
 	}
-#endif
-	// Get length 
-	length = READ_U2(d->source);
-
-#ifdef LIB_INFLATE_ERROR_ENABLED
-	// Get one's complement of length 
-	invlength = READ_U2(d->source + 2);
 
-	// Check length 
-	if (length != (~invlength & 0x0000FFFF)) {
-		return LIB_INFLATE_DATA_ERROR;
-	}
+	*p++ = 'L';
+	*p++ = 'I';
+	*p++ = 'S';
+	*p++ = LIB_INFLATE_STATE_VERSION;
+	p = lib_inflate_state_put(p, d->src_offset + (d->source - d->src_piece), 8);
+	p = lib_inflate_state_put(p, d->total, 8);
+#ifdef LIB_INFLATE_CRC_ENABLED
+	p = lib_inflate_state_put(p, d->crc, 4);
+#else
+	p = lib_inflate_state_put(p, 0, 4);
 #endif
-	d->source += 4;
-
-#ifdef LIB_INFLATE_ERROR_ENABLED
-	if (d->source_end - d->source < length) {
-		return LIB_INFLATE_DATA_ERROR;
+	p = lib_inflate_state_put(p, d->tag, 1);
+	p = lib_inflate_state_put(p, d->bitcount, 1);
+	p = lib_inflate_state_put(p, d->bfinal, 1);
+	p = lib_inflate_state_put(p, (U4) d->btype, 1);
+	p = lib_inflate_state_put(p, pos, 2);
+
+	// Dynamic trees are kept as their code lengths, two per byte 
+	if (d->btype == 2) {
+		U1 lengths[288 + 32];
+		U4 nlit = lib_inflate_tree_lengths(&d->ltree, lengths);
+		U4 ndist = lib_inflate_tree_lengths(&d->dtree, lengths + nlit);
+		p = lib_inflate_state_put(p, nlit, 2);
+		p = lib_inflate_state_put(p, ndist, 1);
+		for (i = 0; i < nlit + ndist; i += 2) {
+			*p++ = lengths[i] | ((i + 1 < nlit + ndist) ? lengths[i + 1] << 4 : 0);
+		}
 	}
 
-	if (d->dest_end - d->dest < length) {
-		return LIB_INFLATE_BUF_ERROR;
-	}
-#endif
-	// Copy block 
-	while (length--) {
-		*d->dest++ = *d->source++;
+	// The window, only the part written so far until it wrapped once 
+	for (i = 0; i < size; ++i) {
+		*p++ = d->dest_start[i];
 	}
-
-	// Make sure we start next block on a byte boundary 
-	d->tag = 0;
-	d->bitcount = 0;
-
-	return LIB_INFLATE_DATA_SUCCESS;
+	d->save(d->ctx, d->state, p - d->state);
 }
 
-// Inflate a block of data compressed with fixed Huffman trees 
-static lib_inflate_data_error_code lib_inflate_inflate_fixed_block(struct lib_inflate_data *d)
+// Restore the decoder state from a snapshot, the next input is expected
+// at the saved offset 
+static lib_inflate_data_error_code lib_inflate_state_restore(struct lib_inflate_data *d,
+                            const U1 *p, U4 len)
 {
-	// Build fixed Huffman trees 
-	lib_inflate_build_fixed_trees(&d->ltree, &d->dtree);
-
-	// Decode block using fixed trees 
-	return lib_inflate_inflate_block_data(d, &d->ltree, &d->dtree);
-}
+	const U1 *end = p + len;
+	U4 i, pos, size;
 
-// Inflate a block of data compressed with dynamic Huffman trees 
-static lib_inflate_data_error_code lib_inflate_inflate_dynamic_block(struct lib_inflate_data *d)
-{
-	// Decode trees from stream 
-#ifdef LIB_INFLATE_ERROR_ENABLED
-	lib_inflate_data_error_code res = 
-#endif
-	lib_inflate_decode_trees(d, &d->ltree, &d->dtree);
 #ifdef LIB_INFLATE_ERROR_ENABLED
-	if (res != LIB_INFLATE_SUCCESS) {
-		return res;
+	if (len < LIB_INFLATE_STATE_HEADER || p[0] != 'L' || p[1] != 'I' || p[2] != 'S'
+	 || p[3] != LIB_INFLATE_STATE_VERSION) {
+		return LIB_INFLATE_DATA_ERROR;
 	}
 #endif
-	// Decode block using decoded trees 
-	return lib_inflate_inflate_block_data(d, &d->ltree, &d->dtree);
-}
-
-// EXTERNAL Library API 
-
-// Inflate stream from source to dest 
-lib_inflate_data_error_code lib_inflate_uncompress(
-										void *pDest, U4 *pLen,
-                    const void *pSrc, U4 len)
-{
-	struct lib_inflate_data d;
-	I bfinal;
-
-	// Initialise data 
-	d.source = (const U1 *) pSrc;
-	d.source_end = d.source + len;
-	d.tag = 0;
-	d.bitcount = 0;
-	d.overflow = 0;
-
-	d.dest = (U1*) pDest;
-	d.dest_start = d.dest;
-	d.dest_end = d.dest + *pLen;
-
-	do {
-		U4 btype;
-#ifdef LIB_INFLATE_ERROR_ENABLED
-		lib_inflate_data_error_code res;
+	d->src_offset = lib_inflate_state_get(p + 4, 8);
+	d->total = lib_inflate_state_get(p + 12, 8);
+#ifdef LIB_INFLATE_CRC_ENABLED
+	d->crc = (U4) lib_inflate_state_get(p + 20, 4);
 #endif
-
-		// Read final block flag 
-		bfinal = lib_inflate_getbits(&d, 1);
-
-		// Read block type (2 bits) 
-		btype = lib_inflate_getbits(&d, 2);
-
-		// Decompress block 
-		switch (btype) {
-		case 0:
-			// Decompress uncompressed block 
+	d->tag = p[24];
+	d->bitcount = p[25];
+	d->bfinal = p[26];
+	d->btype = (p[27] == 0xFF) ? -1 : p[27];
+	pos = (U4) lib_inflate_state_get(p + 28, 2);
+	p += LIB_INFLATE_STATE_HEADER;
+
+	if (d->btype == 1) {
+		lib_inflate_build_fixed_trees(&d->ltree, &d->dtree);
+	}
+	else if (d->btype == 2) {
+		U1 lengths[288 + 32];
+		U4 nlit, ndist;
 #ifdef LIB_INFLATE_ERROR_ENABLED
-			res = 
+		lib_inflate_data_error_code res;
+		if (end - p < 3) {
+			return LIB_INFLATE_DATA_ERROR;
+		}
 #endif
-			lib_inflate_inflate_uncompressed_block(&d);
-			break;
-		case 1:
-			// Decompress block with fixed Huffman trees 
+		nlit = (U4) lib_inflate_state_get(p, 2);
+		ndist = p[2];
+		p += 3;
 #ifdef LIB_INFLATE_ERROR_ENABLED
-			res = 
+		if (nlit > 288 || ndist > 32 || (U4) (end - p) < (nlit + ndist + 1) / 2) {
+			return LIB_INFLATE_DATA_ERROR;
+		}
 #endif
-			lib_inflate_inflate_fixed_block(&d);
-			break;
-		case 2:
-			// Decompress block with dynamic Huffman trees 
+		for (i = 0; i < nlit + ndist; ++i) {
+			lengths[i] = (p[i / 2] >> ((i & 1) * 4)) & 0x0F;
+		}
+		p += (nlit + ndist + 1) / 2;
 #ifdef LIB_INFLATE_ERROR_ENABLED
-			res = 
+		res = 
 #endif
-			lib_inflate_inflate_dynamic_block(&d);
-			break;
+		lib_inflate_build_tree(&d->ltree, lengths, nlit);
 #ifdef LIB_INFLATE_ERROR_ENABLED
-		default:
-			res = LIB_INFLATE_DATA_ERROR;
-			break;
-#endif
+		if (res != LIB_INFLATE_DATA_SUCCESS) {
+			return res;
 		}
+		res = 
+#endif
+		lib_inflate_build_tree(&d->dtree, lengths + nlit, ndist);
 #ifdef LIB_INFLATE_ERROR_ENABLED
-		if (res != LIB_INFLATE_SUCCESS) {
+		if (res != LIB_INFLATE_DATA_SUCCESS) {
 			return res;
 		}
 #endif
-	} while (!bfinal);
+	}
 
+	size = (d->total ? d->dest_end - d->dest_start : pos);
 #ifdef LIB_INFLATE_ERROR_ENABLED
-	// Check for overflow in bit reader 
-	if (d.overflow) {
+	if (d->bitcount > 7 || d->btype == 0 || d->btype > 2 || pos >= (U4) (d->dest_end - d->dest_start)
+	 || (U4) (end - p) != size) {
 		return LIB_INFLATE_DATA_ERROR;
 	}
 #endif
-	*pLen = d.dest - d.dest_start;
+	UNUSED(end);
+	for (i = 0; i < size; ++i) {
+		d->dest_start[i] = *p++;
+	}
+	d->dest = d->dest_start + pos;
 	return LIB_INFLATE_DATA_SUCCESS;
 }
 
-lib_inflate_error_code lib_inflate_gzip_uncompress(
-												void *pDest, U4 *pLen,
-                        const void *pSrc, U4 len)
+I lib_inflate_state_offsets(const void *pState, U4 len, U8 *pSrcOffset, U8 *pDestOffset)
+{
+	const U1 *p = (const U1 *) pState;
+
+	if (len < LIB_INFLATE_STATE_HEADER || p[0] != 'L' || p[1] != 'I' || p[2] != 'S'
+	 || p[3] != LIB_INFLATE_STATE_VERSION) {
+		return 0;
+	}
+	*pSrcOffset = lib_inflate_state_get(p + 4, 8);
+	*pDestOffset = lib_inflate_state_get(p + 12, 8);
+	return 1;
+}
+
+// -- Block inflate functions -- 
+
+// Extra bits and base tables for length codes 
+static const U1 length_bits[30] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+	1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+	4, 4, 4, 4, 5, 5, 5, 5, 0, 127
+};
+
+static const U2 length_base[30] = {
+	 3,  4,  5,   6,   7,   8,   9,  10,  11,  13,
+	15, 17, 19,  23,  27,  31,  35,  43,  51,  59,
+	67, 83, 99, 115, 131, 163, 195, 227, 258,   0
+};
+
+// Extra bits and base tables for distance codes 
+static const U1 dist_bits[30] = {
+	0, 0,  0,  0,  1,  1,  2,  2,  3,  3,
+	4, 4,  5,  5,  6,  6,  7,  7,  8,  8,
+	9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static const U2 dist_base[30] = {
+	   1,    2,    3,    4,    5,    7,    9,    13,    17,    25,
+	  33,   49,   65,   97,  129,  193,  257,   385,   513,   769,
+	1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+#ifdef LIB_INFLATE_DISPATCH_X86
+// Copy a match 32 bytes at a time when the source does not overlap the chunk 
+__attribute__((target("avx2"))) static void lib_inflate_copy_match_avx2(U1 *dest, I offs, I length)
+{
+	if (offs >= 32) {
+		for (; length >= 32; length -= 32, dest += 32) {
+			_mm256_storeu_si256((__m256i *) dest,
+			                    _mm256_loadu_si256((const __m256i *) (dest - offs)));
+		}
+	}
+	for (; length > 0; --length, ++dest) {
+		*dest = dest[-offs];
+	}
+}
+#endif
+
+// Worst case input bytes and output bytes of a single literal or match 
+#define LIB_INFLATE_FAST_SRC  8
+#define LIB_INFLATE_FAST_DEST 258
+
+// Modes of the symbol decoder 
+#define LIB_INFLATE_MODE_WIDE       1 // AVX2 match copies 
+#define LIB_INFLATE_MODE_CHECK_SRC  2 // Check the bit reader for overflow 
+#define LIB_INFLATE_MODE_CHECK_DEST 4 // Check for room in the output 
+#define LIB_INFLATE_MODE_WINDOW     8 // Output to a circular window 
+#define LIB_INFLATE_MODE_SEGMENTS  16 // Output to a list of segments 
+#define LIB_INFLATE_MODE_PREFIX    32 // Stop when the output is full 
+#define LIB_INFLATE_MODE_TABLE     64 // Decode with the lookup tables, in the fast loop only 
+
+// Given a stream and two trees, inflate a single literal or match,
+// returns 1 at the end of the block, 0 to continue or an error code,
+// `mode` is a constant combination of LIB_INFLATE_MODE_... 
+LIB_INFLATE_INLINE I lib_inflate_inflate_symbol(struct lib_inflate_data *d,
+                                    const struct lib_inflate_tree *lt,
+                                    const struct lib_inflate_tree *dt,
+                                    const I mode)
+{
+	I sym;
+
+#if LIB_INFLATE_TABLE_BITS > 0
+	if (mode & LIB_INFLATE_MODE_TABLE) {
+		U4 e;
+		lib_inflate_refill(d, LIB_INFLATE_TABLE_BITS);
+		e = d->ltable[d->tag & LIB_INFLATE_TABLE_MASK];
+		if (!e) {
+			sym = lib_inflate_decode_symbol(d, lt);
+		}
+		else {
+			lib_inflate_getbits_no_refill(d, LIB_INFLATE_ENTRY_BITS(e));
+			sym = LIB_INFLATE_ENTRY_SYM(e);
+			if (LIB_INFLATE_ENTRY_NUM(e) == 2) {
+				// Two literals in one store, the fast loop has room for both 
+				WRITE_U2(d->dest, LIB_INFLATE_ENTRY_PAIR(e));
+				d->dest += 2;
+				return 0;
+			}
+		}
+	}
+	else
+#endif
+	sym = lib_inflate_decode_symbol(d, lt);
+
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	// Check for overflow in bit reader 
+	if ((mode & LIB_INFLATE_MODE_CHECK_SRC) && d->overflow) {
+		return LIB_INFLATE_DATA_ERROR;
+	}
+#endif
+	if (sym < 256) {
+		if ((mode & LIB_INFLATE_MODE_SEGMENTS) && d->dest == d->dest_end
+		 && !lib_inflate_segment_next(d)) {
+#ifdef LIB_INFLATE_ERROR_ENABLED
+			return LIB_INFLATE_BUF_ERROR;
+#endif
+		}
+		if ((mode & LIB_INFLATE_MODE_PREFIX) && d->dest == d->dest_end) {
+			d->stopped = 1;
+			return 1;
+		}
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		if ((mode & LIB_INFLATE_MODE_CHECK_DEST) && d->dest == d->dest_end) {
+			return LIB_INFLATE_BUF_ERROR;
+		}
+#endif
+		*d->dest++ = sym;
+		if ((mode & LIB_INFLATE_MODE_WINDOW) && d->dest == d->dest_end) {
+			lib_inflate_window_flush(d);
+		}
+	}
+	else {
+		I length, dist, offs;
+		I i;
+
+		// Check for end of block 
+		if (sym == 256) {
+			return 1;
+		}
+
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		// Check sym is within range and distance tree is not empty 
+		if (sym > lt->max_sym || sym - 257 > 28 || dt->max_sym == -1) {
+			return LIB_INFLATE_DATA_ERROR;
+		}
+#endif
+		sym -= 257;
+
+		// Possibly get more bits from length code 
+		length = lib_inflate_getbits_base(d, length_bits[sym],
+		                           length_base[sym]);
+
+#if LIB_INFLATE_TABLE_BITS > 0
+		if (mode & LIB_INFLATE_MODE_TABLE) {
+			U4 e;
+			lib_inflate_refill(d, LIB_INFLATE_TABLE_BITS);
+			e = d->dtable[d->tag & LIB_INFLATE_TABLE_MASK];
+			if (!e) {
+				dist = lib_inflate_decode_symbol(d, dt);
+			}
+			else {
+				lib_inflate_getbits_no_refill(d, LIB_INFLATE_ENTRY_BITS(e));
+				dist = LIB_INFLATE_ENTRY_SYM(e);
+			}
+		}
+		else
+#endif
+		dist = lib_inflate_decode_symbol(d, dt);
+
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		// Check dist is within range 
+		if (dist > dt->max_sym || dist > 29) {
+			return LIB_INFLATE_DATA_ERROR;
+		}
+#endif
+		// Possibly get more bits from distance code 
+		offs = lib_inflate_getbits_base(d, dist_bits[dist],
+		                         dist_base[dist]);
+
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		if (offs > d->dest - d->dest_start
+		 && !((mode & LIB_INFLATE_MODE_WINDOW) && d->total)
+		 && !(mode & LIB_INFLATE_MODE_SEGMENTS)) {
+			return LIB_INFLATE_DATA_ERROR;
+		}
+#endif
+		// Matches within the current segment take the plain copy below 
+		if ((mode & LIB_INFLATE_MODE_SEGMENTS)
+		 && (offs > d->dest - d->dest_start || d->dest_end - d->dest < length)) {
+			return lib_inflate_segment_match(d, offs, length);
+		}
+		// Copy only the part of the match that fits 
+		if ((mode & LIB_INFLATE_MODE_PREFIX) && d->dest_end - d->dest < length) {
+			length = d->dest_end - d->dest;
+			d->stopped = 1;
+		}
+#ifdef LIB_INFLATE_ERROR_ENABLED
+
+		if ((mode & LIB_INFLATE_MODE_CHECK_DEST) && d->dest_end - d->dest < length) {
+			return LIB_INFLATE_BUF_ERROR;
+		}
+#endif
+		// Copy match 
+		if (mode & LIB_INFLATE_MODE_WINDOW) {
+			const U1 *from = d->dest - offs;
+			if (from < d->dest_start) {
+				from += d->dest_end - d->dest_start;
+			}
+			for (i = 0; i < length; ++i) {
+				*d->dest++ = *from++;
+				if (from == d->dest_end) {
+					from = d->dest_start;
+				}
+				if (d->dest == d->dest_end) {
+					lib_inflate_window_flush(d);
+				}
+			}
+			return 0;
+		}
+#ifdef LIB_INFLATE_DISPATCH_X86
+		if (mode & LIB_INFLATE_MODE_WIDE) {
+			lib_inflate_copy_match_avx2(d->dest, offs, length);
+		}
+		else
+#endif
+		for (i = 0; i < length; ++i) {
+			d->dest[i] = d->dest[i - offs];
+		}
+
+		d->dest += length;
+		if (mode & LIB_INFLATE_MODE_PREFIX) {
+			return d->stopped;
+		}
+	}
+	return 0;
+}
+
+// Given a stream and two trees, inflate a block of data, this is the
+// body of all decode loop variants 
+LIB_INFLATE_INLINE lib_inflate_data_error_code lib_inflate_inflate_block_loop(
+																	struct lib_inflate_data *d, 
+																	const struct lib_inflate_tree *lt,
+                                  const struct lib_inflate_tree *dt,
+                                  const I mode)
+{
+	for (;;) {
+		I res;
+#if LIB_INFLATE_TABLE_BITS > 0
+		// Fast loop with the lookup tables of the block, the tables look
+		// ahead in the input and store two literals at once 
+		while (d->tables && !(mode & LIB_INFLATE_MODE_WINDOW)
+		    && (d->source_end - d->source >= LIB_INFLATE_FAST_SRC)
+		    && (d->dest_end - d->dest >= LIB_INFLATE_FAST_DEST)) {
+			res = lib_inflate_inflate_symbol(d, lt, dt, mode | LIB_INFLATE_MODE_TABLE);
+			if (res) {
+#ifdef LIB_INFLATE_ERROR_ENABLED
+				if (res < 0) {
+					return (lib_inflate_data_error_code) res;
+				}
+#endif
+				return LIB_INFLATE_DATA_SUCCESS;
+			}
+		}
+#endif
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		// Fast loop, while the worst case symbol can neither overflow the bit
+		// reader nor the output the buffer end checks are skipped 
+		while (!(mode & LIB_INFLATE_MODE_WINDOW)
+		    && (d->source_end - d->source >= LIB_INFLATE_FAST_SRC)
+		    && (d->dest_end - d->dest >= LIB_INFLATE_FAST_DEST)) {
+			res = lib_inflate_inflate_symbol(d, lt, dt, mode);
+			if (res) {
+				if (res < 0) {
+					return (lib_inflate_data_error_code) res;
+				}
+				return LIB_INFLATE_DATA_SUCCESS;
+			}
+		}
+#endif
+		// Careful step near the buffer ends, the input may continue in the
+		// next piece from the read callback, a circular window never runs
+		// out of room 
+		res = lib_inflate_inflate_symbol(d, lt, dt, mode | LIB_INFLATE_MODE_CHECK_SRC
+		                   | ((mode & LIB_INFLATE_MODE_WINDOW) ? 0 : LIB_INFLATE_MODE_CHECK_DEST));
+		if (res) {
+#ifdef LIB_INFLATE_ERROR_ENABLED
+			if (res < 0) {
+				return (lib_inflate_data_error_code) res;
+			}
+#endif
+			return LIB_INFLATE_DATA_SUCCESS;
+		}
+		// Snapshot once the window was flushed 
+		if ((mode & LIB_INFLATE_MODE_WINDOW) && d->save_due) {
+			lib_inflate_state_save(d);
+		}
+	}
+}
+
+typedef lib_inflate_data_error_code (*lib_inflate_block_data_fn)(
+																	struct lib_inflate_data *d, 
+																	const struct lib_inflate_tree *lt,
+                                  const struct lib_inflate_tree *dt);
+
+// Portable decode loop 
+static lib_inflate_data_error_code lib_inflate_inflate_block_data_generic(
+																	struct lib_inflate_data *d, 
+																	const struct lib_inflate_tree *lt,
+                                  const struct lib_inflate_tree *dt)
+{
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	return 
+#endif
+	lib_inflate_inflate_block_loop(d, lt, dt, 0);
+}
+
+#ifdef LIB_INFLATE_DISPATCH_X86
+// Decode loop with bzhi/shrx bit extraction 
+__attribute__((target("bmi2"))) static lib_inflate_data_error_code lib_inflate_inflate_block_data_bmi2(
+																	struct lib_inflate_data *d, 
+																	const struct lib_inflate_tree *lt,
+                                  const struct lib_inflate_tree *dt)
+{
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	return 
+#endif
+	lib_inflate_inflate_block_loop(d, lt, dt, 0);
+}
+
+// Decode loop with bzhi/shrx bit extraction and 32 byte match copies 
+__attribute__((target("bmi2,avx2"))) static lib_inflate_data_error_code lib_inflate_inflate_block_data_avx2(
+																	struct lib_inflate_data *d, 
+																	const struct lib_inflate_tree *lt,
+                                  const struct lib_inflate_tree *dt)
+{
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	return 
+#endif
+	lib_inflate_inflate_block_loop(d, lt, dt, LIB_INFLATE_MODE_WIDE);
+}
+#endif
+
+// Decode loop into a circular window 
+static lib_inflate_data_error_code lib_inflate_inflate_block_data_window(
+																	struct lib_inflate_data *d, 
+																	const struct lib_inflate_tree *lt,
+                                  const struct lib_inflate_tree *dt)
+{
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	return 
+#endif
+	lib_inflate_inflate_block_loop(d, lt, dt, LIB_INFLATE_MODE_WINDOW);
+}
+
+// Decode loop into a list of segments 
+static lib_inflate_data_error_code lib_inflate_inflate_block_data_segments(
+																	struct lib_inflate_data *d, 
+																	const struct lib_inflate_tree *lt,
+                                  const struct lib_inflate_tree *dt)
+{
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	return 
+#endif
+	lib_inflate_inflate_block_loop(d, lt, dt, LIB_INFLATE_MODE_SEGMENTS);
+}
+
+// Decode loop that stops when the output is full 
+static lib_inflate_data_error_code lib_inflate_inflate_block_data_prefix(
+																	struct lib_inflate_data *d, 
+																	const struct lib_inflate_tree *lt,
+                                  const struct lib_inflate_tree *dt)
+{
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	return 
+#endif
+	lib_inflate_inflate_block_loop(d, lt, dt, LIB_INFLATE_MODE_PREFIX);
+}
+
+// Decode loop variant in use, decoders only read it 
+static lib_inflate_block_data_fn lib_inflate_inflate_block_data = lib_inflate_inflate_block_data_generic;
+
+lib_inflate_variant lib_inflate_set_variant(lib_inflate_variant variant)
+{
+#ifdef LIB_INFLATE_DISPATCH_X86
+	__builtin_cpu_init();
+	if (variant == LIB_INFLATE_VARIANT_AUTO) {
+		variant = LIB_INFLATE_VARIANT_AVX2;
+	}
+	if (variant == LIB_INFLATE_VARIANT_AVX2 && __builtin_cpu_supports("avx2")
+	 && __builtin_cpu_supports("bmi2")) {
+		lib_inflate_inflate_block_data = lib_inflate_inflate_block_data_avx2;
+		return LIB_INFLATE_VARIANT_AVX2;
+	}
+	if (variant != LIB_INFLATE_VARIANT_GENERIC && __builtin_cpu_supports("bmi2")) {
+		lib_inflate_inflate_block_data = lib_inflate_inflate_block_data_bmi2;
+		return LIB_INFLATE_VARIANT_BMI2;
+	}
+#else
+	UNUSED(variant);
+#endif
+	lib_inflate_inflate_block_data = lib_inflate_inflate_block_data_generic;
+	return LIB_INFLATE_VARIANT_GENERIC;
+}
+
+#ifdef LIB_INFLATE_DISPATCH_X86
+// Pick the best variant once at load time, before any decoder thread runs 
+__attribute__((constructor)) static void lib_inflate_select_variant(void)
+{
+	lib_inflate_set_variant(LIB_INFLATE_VARIANT_AUTO);
+}
+#endif
+
+// Inflate an uncompressed block of data 
+static lib_inflate_data_error_code lib_inflate_inflate_uncompressed_block(struct lib_inflate_data *d)
+{
+	U4 length, invlength;
+
+	// Start on a byte boundary, whole bytes the lookup tables read ahead
+	// are handed back to the input 
+#if LIB_INFLATE_TABLE_BITS > 0
+	if (!d->overflow) {
+		d->source -= d->bitcount >> 3;
+	}
+#endif
+	d->tag = 0;
+	d->bitcount = 0;
+
+	// Get length and one's complement of length 
+	length = lib_inflate_getbits(d, 16);
+	invlength = lib_inflate_getbits(d, 16);
+	UNUSED(invlength);
+
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	if (d->overflow) {
+		return LIB_INFLATE_DATA_ERROR;
+	}
+
+	// Check length 
+	if (length != (~invlength & 0x0000FFFF)) {
+		return LIB_INFLATE_DATA_ERROR;
+	}
+#endif
+
+	// Copy only the part of the block that fits
+	if (d->prefix && d->dest_end - d->dest < length) {
+		length = d->dest_end - d->dest;
+		d->stopped = 1;
+	}
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	if (!d->window && !d->segs && d->dest_end - d->dest < length) {
+		return LIB_INFLATE_BUF_ERROR;
+	}
+#endif
+	// Copy block, piece by piece of input and window or segments 
+	while (length) {
+		U4 n;
+		if (d->segs && d->dest == d->dest_end && !lib_inflate_segment_next(d)) {
+#ifdef LIB_INFLATE_ERROR_ENABLED
+			return LIB_INFLATE_BUF_ERROR;
+#else
+			break;
+#endif
+		}
+		if (d->source == d->source_end && !lib_inflate_pull(d)) {
+#ifdef LIB_INFLATE_ERROR_ENABLED
+			return LIB_INFLATE_DATA_ERROR;
+#else
+			break;
+#endif
+		}
+		n = length;
+		if (d->source_end - d->source < n) {
+			n = d->source_end - d->source;
+		}
+		if ((d->window || d->segs) && d->dest_end - d->dest < n) {
+			n = d->dest_end - d->dest;
+		}
+		length -= n;
+		while (n--) {
+			*d->dest++ = *d->source++;
+		}
+		if (d->window && d->dest == d->dest_end) {
+			lib_inflate_window_flush(d);
+		}
+	}
+
+	return LIB_INFLATE_DATA_SUCCESS;
+}
+
+#if LIB_INFLATE_TABLE_BITS > 0
+// Decide whether the lookup tables pay off for the block ahead, from the
+// input left and the code lengths of its literal/length tree 
+static I lib_inflate_use_tables(const struct lib_inflate_data *d)
+{
+	I shortest, longest;
+	U8 expected;
+
+	for (shortest = 1; shortest < 15 && !d->ltree.counts[shortest]; ++shortest);
+	for (longest = 15; longest > 1 && !d->ltree.counts[longest]; --longest);
+
+	// A code of length n takes a block of at least about Fib(n + 2)
+	// symbols, short codes come from small blocks, the fixed trees say
+	// nothing about the block 
+	if (d->btype == 2 && (U4) longest < lib_inflate_strategy_in_use.minCodeLen) {
+		return 0;
+	}
+
+	// The block ends within the input left, and within the output left as
+	// every symbol writes at least one byte 
+	expected = (U8) (d->source_end - d->source) * 8 / shortest;
+	if (!d->segs && expected > (U8) (d->dest_end - d->dest)) {
+		expected = d->dest_end - d->dest;
+	}
+	return expected >= lib_inflate_strategy_in_use.minSymbols;
+}
+#endif
+
+// Read the header of the next block and prepare its trees, the data of
+// an uncompressed block is copied right away and leaves btype at -1
+static lib_inflate_data_error_code lib_inflate_inflate_block_header(struct lib_inflate_data *d)
+{
+	U4 btype;
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	lib_inflate_data_error_code res = LIB_INFLATE_DATA_SUCCESS;
+#endif
+
+	// Read final block flag 
+	d->bfinal = lib_inflate_getbits(d, 1);
+
+	// Read block type (2 bits) 
+	btype = lib_inflate_getbits(d, 2);
+
+	d->btype = -1;
+	switch (btype) {
+	case 0:
+		// Decompress uncompressed block 
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		res = 
+#endif
+		lib_inflate_inflate_uncompressed_block(d);
+		break;
+	case 1:
+		// Build fixed Huffman trees 
+		lib_inflate_build_fixed_trees(&d->ltree, &d->dtree);
+		d->btype = 1;
+		break;
+	case 2:
+		// Decode trees from stream 
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		res = 
+#endif
+		lib_inflate_decode_trees(d, &d->ltree, &d->dtree);
+		d->btype = 2;
+		break;
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	default:
+		res = LIB_INFLATE_DATA_ERROR;
+		break;
+#endif
+	}
+#if LIB_INFLATE_TABLE_BITS > 0
+	// Only the fast loops decode with the tables, the window loop has none 
+	d->tables = 0;
+	if (d->btype > 0 && !d->window
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	 && res == LIB_INFLATE_DATA_SUCCESS
+#endif
+	) {
+		// Runs of fixed blocks share their tables 
+		if (d->btype == 1 && d->tables_fixed) {
+			d->tables = 1;
+		}
+		else if (lib_inflate_use_tables(d)) {
+			lib_inflate_build_table(d->ltable, &d->ltree, 1);
+			lib_inflate_build_table(d->dtable, &d->dtree, 0);
+			d->tables = 1;
+			d->tables_fixed = (d->btype == 1);
+		}
+	}
+#endif
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	return res;
+#endif
+}
+
+// Initialise a stream for decompression from source to dest 
+static void lib_inflate_init(struct lib_inflate_data *d,
+                             void *pDest, U8 destLen,
+                             const void *pSrc, U8 len)
+{
+	d->source = (const U1 *) pSrc;
+	d->source_end = d->source + len;
+	d->tag = 0;
+	d->bitcount = 0;
+	d->overflow = 0;
+
+	d->dest = (U1*) pDest;
+	d->dest_start = d->dest;
+	d->dest_end = d->dest + destLen;
+
+	d->bfinal = 0;
+	d->btype = -1;
+
+	d->window = 0;
+	d->total = 0;
+
+	d->segs = 0;
+	d->num_segs = 0;
+	d->seg = 0;
+
+	d->prefix = 0;
+	d->stopped = 0;
+#if LIB_INFLATE_TABLE_BITS > 0
+	d->tables = 0;
+	d->tables_fixed = 0;
+#endif
+
+	d->read = 0;
+	d->write = 0;
+	d->save = 0;
+	d->ctx = 0;
+	d->src_piece = d->source;
+	d->src_offset = 0;
+
+	d->state = 0;
+	d->save_due = 0;
+#ifdef LIB_INFLATE_CRC_ENABLED
+	d->crc = 0;
+#endif
+}
+
+// Inflate all blocks of a stream using the given decode loop 
+static lib_inflate_data_error_code lib_inflate_inflate_blocks(
+										struct lib_inflate_data *d, lib_inflate_block_data_fn block_data)
+{
+	do {
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		lib_inflate_data_error_code res;
+#endif
+
+		// Decompress block, a restored decoder may be inside one already 
+		if (d->btype < 0) {
+			if (d->save_due) {
+				lib_inflate_state_save(d);
+			}
+#ifdef LIB_INFLATE_ERROR_ENABLED
+			res = 
+#endif
+			lib_inflate_inflate_block_header(d);
+#ifdef LIB_INFLATE_ERROR_ENABLED
+			if (res != LIB_INFLATE_SUCCESS) {
+				return res;
+			}
+#endif
+		}
+		if (d->btype > 0) {
+#ifdef LIB_INFLATE_ERROR_ENABLED
+			res = 
+#endif
+			block_data(d, &d->ltree, &d->dtree);
+#ifdef LIB_INFLATE_ERROR_ENABLED
+			if (res != LIB_INFLATE_SUCCESS) {
+				return res;
+			}
+#endif
+			d->btype = -1;
+		}
+	} while (!d->bfinal && !d->stopped);
+
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	// Check for overflow in bit reader 
+	if (d->overflow) {
+		return LIB_INFLATE_DATA_ERROR;
+	}
+#endif
+	return LIB_INFLATE_DATA_SUCCESS;
+}
+
+// EXTERNAL Library API 
+
+// Inflate stream from source to dest 
+lib_inflate_data_error_code lib_inflate_uncompress(
+										void *pDest, U4 *pLen,
+                    const void *pSrc, U4 len)
+{
+	U8 destLen = *pLen;
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	lib_inflate_data_error_code res = 
+#endif
+	lib_inflate_uncompress64(pDest, &destLen, pSrc, len);
+	*pLen = (U4) destLen;
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	return res;
+#endif
+}
+
+// Inflate stream from source to dest, sizes beyond 4 GB 
+lib_inflate_data_error_code lib_inflate_uncompress64(
+										void *pDest, U8 *pLen,
+                    const void *pSrc, U8 len)
+{
+	struct lib_inflate_data d;
+
+	// Initialise data 
+	lib_inflate_init(&d, pDest, *pLen, pSrc, len);
+
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	{
+		lib_inflate_data_error_code res = 
+#endif
+		lib_inflate_inflate_blocks(&d, lib_inflate_inflate_block_data);
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		if (res != LIB_INFLATE_SUCCESS) {
+			return res;
+		}
+	}
+#endif
+	*pLen = d.dest - d.dest_start;
+	return LIB_INFLATE_DATA_SUCCESS;
+}
+
+// Inflate stream from source to dest until dest is full, `*pComplete` is
+// set if the stream ended before 
+static lib_inflate_data_error_code lib_inflate_prefix(
+										void *pDest, U4 *pLen,
+                    const void *pSrc, U4 *pSrcLen, I *pComplete)
+{
+	struct lib_inflate_data d;
+
+	lib_inflate_init(&d, pDest, *pLen, pSrc, *pSrcLen);
+	d.prefix = 1;
+
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	{
+		lib_inflate_data_error_code res = 
+#endif
+		lib_inflate_inflate_blocks(&d, lib_inflate_inflate_block_data_prefix);
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		if (res != LIB_INFLATE_SUCCESS) {
+			return res;
+		}
+	}
+#endif
+	*pLen = d.dest - d.dest_start;
+	// Whole bytes left in the bit reader were not used 
+	*pSrcLen = (d.source - (const U1 *) pSrc) - d.bitcount / 8;
+	// The decoder only stops early when the output is full 
+	*pComplete = !d.stopped;
+	return LIB_INFLATE_DATA_SUCCESS;
+}
+
+// Inflate stream from source to dest until dest is full 
+lib_inflate_data_error_code lib_inflate_uncompress_prefix(
+										void *pDest, U4 *pLen,
+                    const void *pSrc, U4 *pSrcLen)
+{
+	I complete;
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	return 
+#endif
+	lib_inflate_prefix(pDest, pLen, pSrc, pSrcLen, &complete);
+}
+
+// Inflate stream from source to a list of segments 
+lib_inflate_data_error_code lib_inflate_uncompress_segments(
+										const lib_inflate_segment *pSegs, U4 num, U4 *pLen,
+                    const void *pSrc, U4 len)
+{
+	struct lib_inflate_data d;
+
+	// Start in the first segment, empty segments are skipped on the first write 
+	lib_inflate_init(&d, num ? pSegs[0].pDest : 0, num ? pSegs[0].len : 0, pSrc, len);
+	d.segs = pSegs;
+	d.num_segs = num;
+
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	{
+		lib_inflate_data_error_code res = 
+#endif
+		lib_inflate_inflate_blocks(&d, lib_inflate_inflate_block_data_segments);
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		if (res != LIB_INFLATE_SUCCESS) {
+			return res;
+		}
+	}
+#endif
+	*pLen = d.total + (d.dest - d.dest_start);
+	return LIB_INFLATE_DATA_SUCCESS;
+}
+
+// Inflate several independent streams in lockstep, one symbol of each
+// stream per round, so that the dependent loads of the streams overlap 
+lib_inflate_data_error_code lib_inflate_uncompress_multi(
+										lib_inflate_stream *pStreams, U4 num)
+{
+	struct lib_inflate_data d[LIB_INFLATE_MULTI_MAX];
+	U4 i, active;
+
+	// More streams than decoder states never get decoded 
+	if (num > LIB_INFLATE_MULTI_MAX) {
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		return LIB_INFLATE_BUF_ERROR;
+#else
+		num = LIB_INFLATE_MULTI_MAX;
+#endif
+	}
+	for (i = 0; i < num; ++i) {
+		lib_inflate_init(&d[i], pStreams[i].pDest, pStreams[i].len,
+		                 pStreams[i].pSrc, pStreams[i].srcLen);
+	}
+
+	do {
+		active = 0;
+		for (i = 0; i < num; ++i) {
+			struct lib_inflate_data *s = &d[i];
+			if (s->btype > 0) {
+				// Inflate next symbol of current block, without the buffer
+				// end checks and with the lookup tables while far from the
+				// buffer ends, as the fast loops of a single stream 
+				I res;
+				if (s->source_end - s->source >= LIB_INFLATE_FAST_SRC
+				 && s->dest_end - s->dest >= LIB_INFLATE_FAST_DEST) {
+#if LIB_INFLATE_TABLE_BITS > 0
+					if (s->tables) {
+						res = lib_inflate_inflate_symbol(s, &s->ltree, &s->dtree, LIB_INFLATE_MODE_TABLE);
+					}
+					else
+#endif
+					res = lib_inflate_inflate_symbol(s, &s->ltree, &s->dtree, 0);
+				}
+				else {
+					res = lib_inflate_inflate_symbol(s, &s->ltree, &s->dtree,
+					                         LIB_INFLATE_MODE_CHECK_SRC | LIB_INFLATE_MODE_CHECK_DEST);
+				}
+				if (res) {
+#ifdef LIB_INFLATE_ERROR_ENABLED
+					if (res < 0) {
+						return (lib_inflate_data_error_code) res;
+					}
+#endif
+					s->btype = -1;
+				}
+				active = 1;
+			}
+			else if (!s->bfinal) {
+				// Start next block 
+#ifdef LIB_INFLATE_ERROR_ENABLED
+				lib_inflate_data_error_code res = 
+#endif
+				lib_inflate_inflate_block_header(s);
+#ifdef LIB_INFLATE_ERROR_ENABLED
+				if (res != LIB_INFLATE_SUCCESS) {
+					return res;
+				}
+#endif
+				active = 1;
+			}
+		}
+	} while (active);
+
+	for (i = 0; i < num; ++i) {
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		// Check for overflow in bit reader 
+		if (d[i].overflow) {
+			return LIB_INFLATE_DATA_ERROR;
+		}
+#endif
+		pStreams[i].len = d[i].dest - d[i].dest_start;
+	}
+	return LIB_INFLATE_DATA_SUCCESS;
+}
+
+// Check the gzip header and find the start of the compressed data 
+static lib_inflate_error_code lib_inflate_gzip_header(
+												const U1 *src, U4 len, const U1 **pStart)
+{
+	const U1 *start;
+	tinf_gzip_flag flg;
+	UNUSED(len);
+
+	// -- Check header -- 
+
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	// Check room for at least 10 byte header and 8 byte trailer 
+	if (len < 18) {
+		return LIB_INFLATE_DATA_ERROR;
+	}
+
+	// Check id bytes 
+	if (src[0] != 0x1F || src[1] != 0x8B) {
+		return LIB_INFLATE_DATA_ERROR;
+	}
+
+	// Check method is deflate 
+	if (src[2] != 8) {
+		return LIB_INFLATE_DATA_ERROR;
+	}
+#endif
+
+	// Get flag byte 
+	flg = src[3];
+
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	// Check that reserved bits are zero 
+	if (flg & 0xE0) {
+		return LIB_INFLATE_DATA_ERROR;
+	}
+#endif
+
+	// -- Find start of compressed data -- 
+
+	// Skip base header of 10 bytes 
+	start = src + 10;
+	// Skip extra data if present 
+	if (flg & FEXTRA) {
+		U4 xlen = READ_U2(start);
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		if (xlen > len - 12) {
+			return LIB_INFLATE_DATA_ERROR;
+		}
+#endif
+		start += xlen + 2;
+	}
+
+	// Skip file name if present 
+	if (flg & FNAME) {
+		do {
+#ifdef LIB_INFLATE_ERROR_ENABLED
+			if (start - src >= len) {
+				return LIB_INFLATE_DATA_ERROR;
+			}
+#endif
+		} while (*start++);
+	}
+
+	// Skip file comment if present 
+	if (flg & FCOMMENT) {
+		do {
+#ifdef LIB_INFLATE_ERROR_ENABLED
+			if (start - src >= len) {
+				return LIB_INFLATE_DATA_ERROR;
+			}
+#endif
+		} while (*start++);
+	}
+
+	// Check header crc if present 
+	if (flg & FHCRC) {
+#ifdef LIB_INFLATE_CRC_ENABLED
+		U4 hcrc;
+#endif
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		if (start - src > len - 2) {
+			return LIB_INFLATE_DATA_ERROR;
+		}
+#endif
+#ifdef LIB_INFLATE_CRC_ENABLED
+		hcrc = READ_U2(start);
+		if (hcrc != (lib_crc32(src, start - src) & 0x0000FFFF)) {
+			return LIB_INFLATE_CRC_ERROR;
+		}
+#endif
+		start += 2;
+	}
+
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	// Check room for the compressed data and the trailer 
+	if ((src + len) - start < 8) {
+		return LIB_INFLATE_DATA_ERROR;
+	}
+#endif
+	*pStart = start;
+	return LIB_INFLATE_SUCCESS;
+}
+
+// Check decompressed data against length and CRC32 of the gzip trailer 
+static lib_inflate_error_code lib_inflate_gzip_trailer(
+												const U1 *src, U4 len, const void *pDest, U8 destLen)
+{
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	// -- Check decompressed length, the trailer holds it modulo 2^32 -- 
+	if ((U4) destLen != READ_U4(&src[len - 4])) {
+		return LIB_INFLATE_DATA_ERROR;
+	}
+#endif
+#ifdef LIB_INFLATE_CRC_ENABLED
+	// -- Check CRC32 checksum of original data -- 
+	if (READ_U4(&src[len - 8]) != lib_inflate_crc32_long(pDest, destLen)) {
+		return LIB_INFLATE_CRC_ERROR;
+	}
+#endif
+	UNUSED(src);
+	UNUSED(len);
+	UNUSED(pDest);
+	UNUSED(destLen);
+	return LIB_INFLATE_SUCCESS;
+}
+
+lib_inflate_error_code lib_inflate_gzip_uncompress(
+												void *pDest, U4 *pLen,
+                        const void *pSrc, U4 len)
 {
 	const U1 *src = (const U1 *) pSrc;
-	U1 *dst = (U1 *) pDest;
-	const U1 *start;
-#if defined(LIB_INFLATE_ERROR_ENABLED) || defined(LIB_INFLATE_CRC_ENABLED)
-	U4 dlen;
+	const U1 *start = src;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	lib_inflate_error_code res;
+#endif
+
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	res = 
+#endif
+	lib_inflate_gzip_header(src, len, &start);
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	if (res != LIB_INFLATE_SUCCESS) {
+		return res;
+	}
+#endif
+
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	// -- Get decompressed length -- 
+	if (lib_inflate_gzip_size(src, len) > *pLen) {
+		return LIB_INFLATE_BUF_ERROR;
+	}
+
+	// -- Decompress data -- 
+	res = 
+#endif
+	lib_inflate_uncompress(pDest, pLen, start,
+	                      (src + len) - start - 8);
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	if (res != LIB_INFLATE_DATA_SUCCESS) {
+		return LIB_INFLATE_DATA_ERROR;
+	}
+#endif
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	return 
+#endif
+	lib_inflate_gzip_trailer(src, len, pDest, *pLen);
+}
+
+lib_inflate_error_code lib_inflate_gzip_uncompress64(
+												void *pDest, U8 *pLen,
+                        const void *pSrc, U8 len)
+{
+	const U1 *src = (const U1 *) pSrc;
+	const U1 *start = src;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	lib_inflate_error_code res;
+#endif
+
+	// The header is short, its optional fields stay within the first 4 GB 
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	res = 
+#endif
+	lib_inflate_gzip_header(src, (len > 0xFFFFFFFF) ? 0xFFFFFFFF : (U4) len, &start);
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	if (res != LIB_INFLATE_SUCCESS) {
+		return res;
+	}
+#endif
+
+	// -- Decompress data, the trailer only has the size modulo 2^32 so
+	// `pDest` bounds the output instead -- 
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	res = 
+#endif
+	lib_inflate_uncompress64(pDest, pLen, start,
+	                      (src + len) - start - 8);
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	if (res != LIB_INFLATE_DATA_SUCCESS) {
+		return res;
+	}
+#endif
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	return 
+#endif
+	lib_inflate_gzip_trailer(src + len - 8, 8, pDest, *pLen);
+}
+
+lib_inflate_error_code lib_inflate_gzip_uncompress_prefix(
+												void *pDest, U4 *pLen,
+                        const void *pSrc, U4 *pSrcLen)
+{
+	const U1 *src = (const U1 *) pSrc;
+	const U1 *start = src;
+	U4 len = *pSrcLen, srcLen;
+	I complete;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	lib_inflate_error_code res;
+#endif
+
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	res = 
+#endif
+	lib_inflate_gzip_header(src, len, &start);
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	if (res != LIB_INFLATE_SUCCESS) {
+		return res;
+	}
+#endif
+
+	// -- Decompress data, the size of the stream does not matter -- 
+	srcLen = (src + len) - start - 8;
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	res = 
+#endif
+	lib_inflate_prefix(pDest, pLen, start, &srcLen, &complete);
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	if (res != LIB_INFLATE_DATA_SUCCESS) {
+		return LIB_INFLATE_DATA_ERROR;
+	}
+#endif
+	*pSrcLen = (start - src) + srcLen;
+
+	// -- Check the trailer only if the decoder reached the end of the
+	// stream, the size in the trailer is not trusted for that -- 
+	if (!complete) {
+		return LIB_INFLATE_SUCCESS;
+	}
+	*pSrcLen = len;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	return 
+#endif
+	lib_inflate_gzip_trailer(src, len, pDest, *pLen);
+}
+
+lib_inflate_error_code lib_inflate_gzip_uncompress_segments(
+												const lib_inflate_segment *pSegs, U4 num, U4 *pLen,
+                        const void *pSrc, U4 len)
+{
+	const U1 *src = (const U1 *) pSrc;
+	const U1 *start = src;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	lib_inflate_error_code res;
 #endif
 #ifdef LIB_INFLATE_CRC_ENABLED
-	U4 crc32;
+	U4 i, left, crc = 0;
+#endif
+
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	res = 
+#endif
+	lib_inflate_gzip_header(src, len, &start);
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	if (res != LIB_INFLATE_SUCCESS) {
+		return res;
+	}
 #endif
+
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	res = 
+#endif
+	lib_inflate_uncompress_segments(pSegs, num, pLen, start,
+	                      (src + len) - start - 8);
 #ifdef LIB_INFLATE_ERROR_ENABLED
+	if (res != LIB_INFLATE_DATA_SUCCESS) {
+		return res;
+	}
+
+	// -- Check decompressed length -- 
+	if (*pLen != lib_inflate_gzip_size(src, len)) {
+		return LIB_INFLATE_DATA_ERROR;
+	}
+#endif
+#ifdef LIB_INFLATE_CRC_ENABLED
+	// -- Check CRC32 checksum of original data, segment by segment -- 
+	for (i = 0, left = *pLen; i < num && left; ++i) {
+		U4 n = (pSegs[i].len < left) ? pSegs[i].len : left;
+		crc = lib_inflate_crc32_update(crc, pSegs[i].pDest, n);
+		left -= n;
+	}
+	if (READ_U4(&src[len - 8]) != crc) {
+		return LIB_INFLATE_CRC_ERROR;
+	}
+#endif
+	return LIB_INFLATE_SUCCESS;
+}
+
+// Inflate several independent gzip streams in lockstep 
+lib_inflate_error_code lib_inflate_gzip_uncompress_multi(
+												lib_inflate_stream *pStreams, U4 num)
+{
+	lib_inflate_stream deflate[LIB_INFLATE_MULTI_MAX];
+	U4 i;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
 	lib_inflate_error_code res;
 #endif
+
+	// More streams than decoder states never get decoded 
+	if (num > LIB_INFLATE_MULTI_MAX) {
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		return LIB_INFLATE_BUF_ERROR;
+#else
+		num = LIB_INFLATE_MULTI_MAX;
+#endif
+	}
+	for (i = 0; i < num; ++i) {
+		const U1 *src = (const U1 *) pStreams[i].pSrc;
+		const U1 *start = src;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+		res = 
+#endif
+		lib_inflate_gzip_header(src, pStreams[i].srcLen, &start);
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+		if (res != LIB_INFLATE_SUCCESS) {
+			return res;
+		}
+#endif
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		if (lib_inflate_gzip_size(src, pStreams[i].srcLen) > pStreams[i].len) {
+			return LIB_INFLATE_BUF_ERROR;
+		}
+#endif
+		deflate[i] = pStreams[i];
+		deflate[i].pSrc = start;
+		deflate[i].srcLen = (src + pStreams[i].srcLen) - start - 8;
+	}
+
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	res = 
+#endif
+	lib_inflate_uncompress_multi(deflate, num);
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	if (res != LIB_INFLATE_DATA_SUCCESS) {
+		return LIB_INFLATE_DATA_ERROR;
+	}
+#endif
+
+	for (i = 0; i < num; ++i) {
+		pStreams[i].len = deflate[i].len;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+		res = 
+#endif
+		lib_inflate_gzip_trailer((const U1 *) pStreams[i].pSrc, pStreams[i].srcLen,
+		                        pStreams[i].pDest, pStreams[i].len);
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+		if (res != LIB_INFLATE_SUCCESS) {
+			return res;
+		}
+#endif
+	}
+	return LIB_INFLATE_SUCCESS;
+}
+
+// Read a gzip header byte through the bit reader and add it to the header CRC 
+static U1 lib_inflate_gzip_byte(struct lib_inflate_data *d, U4 *pCrc)
+{
+	U1 c = (U1) lib_inflate_getbits(d, 8);
+#ifdef LIB_INFLATE_CRC_ENABLED
+	*pCrc = lib_inflate_crc32_update(*pCrc, &c, 1);
+#else
+	UNUSED(pCrc);
+#endif
+	return c;
+}
+
+// Check the gzip header read through the bit reader 
+static lib_inflate_error_code lib_inflate_gzip_stream_header(struct lib_inflate_data *d)
+{
+	U1 hdr[4];
+	U4 i, hcrc = 0;
 	tinf_gzip_flag flg;
 
 	// -- Check header -- 
-
-#ifdef LIB_INFLATE_ERROR_ENABLED
-	// Check room for at least 10 byte header and 8 byte trailer 
-	if (len < 18) {
-		return LIB_INFLATE_DATA_ERROR;
-	}
-
-	// Check id bytes 
-	if (src[0] != 0x1F || src[1] != 0x8B) {
-		return LIB_INFLATE_DATA_ERROR;
-	}
-
-	// Check method is deflate 
-	if (src[2] != 8) {
-		return LIB_INFLATE_DATA_ERROR;
+	for (i = 0; i < 10; ++i) {
+		U1 c = lib_inflate_gzip_byte(d, &hcrc);
+		if (i < 4) {
+			hdr[i] = c;
+		}
 	}
-#endif
-
-	// Get flag byte 
-	flg = src[3];
+	flg = hdr[3];
 
 #ifdef LIB_INFLATE_ERROR_ENABLED
-	// Check that reserved bits are zero 
-	if (flg & 0xE0) {
+	// Check id bytes, method is deflate and reserved bits are zero 
+	if (d->overflow || hdr[0] != 0x1F || hdr[1] != 0x8B || hdr[2] != 8
+	 || (flg & 0xE0)) {
 		return LIB_INFLATE_DATA_ERROR;
 	}
 #endif
 
-	// -- Find start of compressed data -- 
-
-	// Skip base header of 10 bytes 
-	start = src + 10;
 	// Skip extra data if present 
 	if (flg & FEXTRA) {
-		U4 xlen = READ_U2(start);
-#ifdef LIB_INFLATE_ERROR_ENABLED
-		if (xlen > len - 12) {
-			return LIB_INFLATE_DATA_ERROR;
+		U4 xlen = lib_inflate_gzip_byte(d, &hcrc);
+		xlen |= (U4) lib_inflate_gzip_byte(d, &hcrc) << 8;
+		while (xlen-- && !d->overflow) {
+			lib_inflate_gzip_byte(d, &hcrc);
 		}
-#endif
-		start += xlen + 2;
 	}
 
-	// Skip file name if present 
+	// Skip file name and comment if present 
 	if (flg & FNAME) {
-		do {
-#ifdef LIB_INFLATE_ERROR_ENABLED
-			if (start - src >= len) {
-				return LIB_INFLATE_DATA_ERROR;
-			}
-#endif
-		} while (*start++);
+		while (lib_inflate_gzip_byte(d, &hcrc) && !d->overflow);
 	}
-
-	// Skip file comment if present 
 	if (flg & FCOMMENT) {
-		do {
-#ifdef LIB_INFLATE_ERROR_ENABLED
-			if (start - src >= len) {
-				return LIB_INFLATE_DATA_ERROR;
-			}
-#endif
-		} while (*start++);
+		while (lib_inflate_gzip_byte(d, &hcrc) && !d->overflow);
 	}
 
 	// Check header crc if present 
 	if (flg & FHCRC) {
+		U4 hcrc16 = lib_inflate_getbits(d, 16);
 #ifdef LIB_INFLATE_CRC_ENABLED
-		U4 hcrc;
-#endif
-#ifdef LIB_INFLATE_ERROR_ENABLED
-		if (start - src > len - 2) {
-			return LIB_INFLATE_DATA_ERROR;
-		}
-#endif
-#ifdef LIB_INFLATE_CRC_ENABLED
-		hcrc = READ_U2(start);
-		if (hcrc != (lib_crc32(src, start - src) & 0x0000FFFF)) {
+		if (hcrc16 != (hcrc & 0x0000FFFF)) {
 			return LIB_INFLATE_CRC_ERROR;
 		}
 #endif
-		start += 2;
+		UNUSED(hcrc16);
 	}
+	UNUSED(hcrc);
 
-	// -- Get decompressed length -- 
-#if defined(LIB_INFLATE_ERROR_ENABLED) || defined(LIB_INFLATE_CRC_ENABLED)
-	dlen = READ_U4(&src[len - 4]);
-#endif
 #ifdef LIB_INFLATE_ERROR_ENABLED
-	if (dlen > *pLen) {
-		return LIB_INFLATE_BUF_ERROR;
+	if (d->overflow) {
+		return LIB_INFLATE_DATA_ERROR;
 	}
 #endif
-#ifdef LIB_INFLATE_CRC_ENABLED
-	// -- Get CRC32 checksum of original data -- 
-	crc32 = READ_U4(&src[len - 8]);
+	return LIB_INFLATE_SUCCESS;
+}
+
+// Decompress a gzip stream into the window of `d`, header and trailer are
+// read through the bit reader so the input may come in pieces, a restored
+// decoder is past the header already 
+static lib_inflate_error_code lib_inflate_gzip_window(struct lib_inflate_data *d, I restored)
+{
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	U4 crc32, dlen;
+	lib_inflate_error_code res;
 #endif
 
-#ifdef LIB_INFLATE_ERROR_ENABLED
-	// -- Decompress data -- 
-	if ((src + len) - start < 8) {
-		return LIB_INFLATE_DATA_ERROR;
+	if (!restored) {
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+		res = 
+#endif
+		lib_inflate_gzip_stream_header(d);
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+		if (res != LIB_INFLATE_SUCCESS) {
+			return res;
+		}
+#endif
 	}
+
+	// -- Decompress data into the window -- 
+	d->window = 1;
+#ifdef LIB_INFLATE_ERROR_ENABLED
 	res = 
 #endif
-	lib_inflate_uncompress(dst, pLen, start,
-	                      (src + len) - start - 8);
+	lib_inflate_inflate_blocks(d, lib_inflate_inflate_block_data_window);
 #ifdef LIB_INFLATE_ERROR_ENABLED
 	if (res != LIB_INFLATE_DATA_SUCCESS) {
 		return LIB_INFLATE_DATA_ERROR;
 	}
-	if (*pLen != dlen) {
+#endif
+	lib_inflate_window_flush(d);
+
+	// -- Check trailer, it starts on a byte boundary -- 
+	d->tag = 0;
+	d->bitcount = 0;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	crc32 = lib_inflate_getbits(d, 16);
+	crc32 |= lib_inflate_getbits(d, 16) << 16;
+	dlen = lib_inflate_getbits(d, 16);
+	dlen |= lib_inflate_getbits(d, 16) << 16;
+#endif
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	if (d->overflow || dlen != (U4) d->total) {
+		return LIB_INFLATE_DATA_ERROR;
+	}
+
+	// -- The input must end with the trailer, the read callback included -- 
+	if (d->source != d->source_end || lib_inflate_pull(d)) {
 		return LIB_INFLATE_DATA_ERROR;
 	}
 #endif
 #ifdef LIB_INFLATE_CRC_ENABLED
-	// -- Check CRC32 checksum -- 
-	if (crc32 != lib_crc32(dst, dlen)) {
+	if (crc32 != d->crc) {
 		return LIB_INFLATE_CRC_ERROR;
 	}
 #endif
-
 	return LIB_INFLATE_SUCCESS;
 }
 
+lib_inflate_error_code lib_inflate_gzip_verify(
+												const void *pSrc, U4 len, void *pWindow)
+{
+	struct lib_inflate_data d;
+
+	lib_inflate_init(&d, pWindow, LIB_INFLATE_WINDOW_SIZE, pSrc, len);
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	return 
+#endif
+	lib_inflate_gzip_window(&d, 0);
+}
+
+lib_inflate_error_code lib_inflate_gzip_uncompress_stream(
+                            lib_inflate_read_fn read, lib_inflate_write_fn write,
+                            void *pCtx, void *pWindow, U4 *pLen)
+{
+	U8 len = 0;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	lib_inflate_error_code res = 
+#endif
+	lib_inflate_gzip_uncompress_stream64(read, write, pCtx, pWindow, &len);
+	*pLen = (U4) len;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	return res;
+#endif
+}
+
+lib_inflate_error_code lib_inflate_gzip_uncompress_stream64(
+                            lib_inflate_read_fn read, lib_inflate_write_fn write,
+                            void *pCtx, void *pWindow, U8 *pLen)
+{
+	struct lib_inflate_data d;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	lib_inflate_error_code res;
+#endif
+
+	lib_inflate_init(&d, pWindow, LIB_INFLATE_WINDOW_SIZE, 0, 0);
+	d.read = read;
+	d.write = write;
+	d.ctx = pCtx;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	res = 
+#endif
+	lib_inflate_gzip_window(&d, 0);
+	*pLen = d.total;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	return res;
+#endif
+}
+
+lib_inflate_error_code lib_inflate_gzip_uncompress_resume(
+                            lib_inflate_read_fn read, lib_inflate_write_fn write,
+                            lib_inflate_save_fn save, void *pCtx, void *pWindow,
+                            void *pState, U4 stateLen, U4 *pLen)
+{
+	U8 len = 0;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	lib_inflate_error_code res = 
+#endif
+	lib_inflate_gzip_uncompress_resume64(read, write, save, pCtx, pWindow,
+	                                     pState, stateLen, &len);
+	*pLen = (U4) len;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	return res;
+#endif
+}
+
+lib_inflate_error_code lib_inflate_gzip_uncompress_resume64(
+                            lib_inflate_read_fn read, lib_inflate_write_fn write,
+                            lib_inflate_save_fn save, void *pCtx, void *pWindow,
+                            void *pState, U4 stateLen, U8 *pLen)
+{
+	struct lib_inflate_data d;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	lib_inflate_error_code res;
+#endif
+
+	lib_inflate_init(&d, pWindow, LIB_INFLATE_WINDOW_SIZE, 0, 0);
+	d.read = read;
+	d.write = write;
+	d.save = save;
+	d.ctx = pCtx;
+	d.state = (U1 *) pState;
+	if (stateLen) {
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		res = 
+#endif
+		lib_inflate_state_restore(&d, d.state, stateLen);
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		if (res != LIB_INFLATE_SUCCESS) {
+			return res;
+		}
+#endif
+	}
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	res = 
+#endif
+	lib_inflate_gzip_window(&d, stateLen != 0);
+	*pLen = d.total;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	return res;
+#endif
+}
+
 U4 lib_inflate_gzip_size(const void *pSrc, U4 len) {
 	const U1 *src = (const U1 *) pSrc;
 	return READ_U4(&src[len - 4]);
@@ -850,4 +2431,180 @@ lib_inflate_error_code lib_inflate_gzipromExecute(void *pDest, const void *pSrc,
 #if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
   return res;
 #endif
-}
\ No newline at end of file
+}
+
+// -- gzrom container -- 
+
+lib_inflate_error_code lib_inflate_gzrom_scan(lib_inflate_gzrom_scan_block *pBlocks,
+                            lib_inflate_tree *pTrees, U4 *pNum,
+                            void *pDest, U4 *pLen, const void *pSrc, U4 len)
+{
+	const U1 *src = (const U1 *) pSrc;
+	const U1 *start = src;
+	struct lib_inflate_data d;
+	U4 num = 0;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	lib_inflate_error_code res;
+#endif
+
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	res = 
+#endif
+	lib_inflate_gzip_header(src, len, &start);
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	if (res != LIB_INFLATE_SUCCESS) {
+		return res;
+	}
+#endif
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	if (lib_inflate_gzip_size(src, len) > *pLen) {
+		return LIB_INFLATE_BUF_ERROR;
+	}
+#endif
+
+	lib_inflate_init(&d, pDest, *pLen, start, (src + len) - start - 8);
+	do {
+		lib_inflate_gzrom_scan_block b;
+		U1 *dest = d.dest;
+
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		res = 
+#endif
+		lib_inflate_inflate_block_header(&d);
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		if (res != LIB_INFLATE_SUCCESS) {
+			return res;
+		}
+#endif
+		b.destOffset = dest - d.dest_start;
+		b.tree = 2 * num;
+		if (d.btype < 0) {
+			// The data of an uncompressed block was copied right away 
+			b.btype = 0;
+			b.destLen = d.dest - dest;
+			b.srcBitOffset = ((d.source - src) - b.destLen) * 8;
+			b.srcBitLen = b.destLen * 8;
+		}
+		else {
+			// Bit positions count the bits the tables read ahead as unread 
+			b.btype = d.btype;
+			b.srcBitOffset = (d.source - src) * 8 - d.bitcount;
+			if (pTrees && num < *pNum) {
+				pTrees[b.tree] = d.ltree;
+				pTrees[b.tree + 1] = d.dtree;
+			}
+#ifdef LIB_INFLATE_ERROR_ENABLED
+			res = 
+#endif
+			lib_inflate_inflate_block_data(&d, &d.ltree, &d.dtree);
+#ifdef LIB_INFLATE_ERROR_ENABLED
+			if (res != LIB_INFLATE_SUCCESS) {
+				return res;
+			}
+#endif
+			d.btype = -1;
+			b.srcBitLen = (d.source - src) * 8 - d.bitcount - b.srcBitOffset;
+			b.destLen = d.dest - dest;
+		}
+		if (pBlocks && num < *pNum) {
+			pBlocks[num] = b;
+		}
+		num++;
+	} while (!d.bfinal);
+
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	if (d.overflow) {
+		return LIB_INFLATE_DATA_ERROR;
+	}
+	if (pBlocks && num > *pNum) {
+		return LIB_INFLATE_BUF_ERROR;
+	}
+#endif
+	*pNum = num;
+	*pLen = d.dest - d.dest_start;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	return 
+#endif
+	lib_inflate_gzip_trailer(src, len, pDest, *pLen);
+}
+
+lib_inflate_error_code lib_inflate_gzrom_uncompress(void *pDest, U4 *pLen,
+                            const lib_inflate_gzrom *pRom)
+{
+	struct lib_inflate_data d;
+	U4 i;
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	lib_inflate_data_error_code res;
+
+	if (pRom->len > *pLen) {
+		return LIB_INFLATE_BUF_ERROR;
+	}
+#endif
+
+	lib_inflate_init(&d, pDest, pRom->len, 0, 0);
+	for (i = 0; i < pRom->num; ++i) {
+		const lib_inflate_gzrom_block *b = &pRom->pBlocks[i];
+
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		// The block must stay within the data and the output, an
+		// uncompressed block within its own data, and its trees must exist 
+		if (b->destOffset > pRom->len || b->destLen > pRom->len - b->destOffset
+		 || b->srcOffset > pRom->dataLen || b->srcLen > pRom->dataLen - b->srcOffset
+		 || (!b->btype && b->destLen > b->srcLen)
+		 || (b->btype && (U4) b->tree + 1 >= pRom->numTrees)) {
+			return LIB_INFLATE_DATA_ERROR;
+		}
+#endif
+		// Each block starts on a byte boundary, its trees are in ROM 
+		d.source = pRom->pData + b->srcOffset;
+		d.source_end = d.source + b->srcLen;
+		d.tag = 0;
+		d.bitcount = 0;
+		d.dest = d.dest_start + b->destOffset;
+		d.dest_end = d.dest + b->destLen;
+		if (!b->btype) {
+			U4 n;
+			for (n = 0; n < b->destLen; ++n) {
+				d.dest[n] = d.source[n];
+			}
+			continue;
+		}
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		res = 
+#endif
+		lib_inflate_inflate_block_data(&d, &pRom->pTrees[b->tree], &pRom->pTrees[b->tree + 1]);
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		if (res != LIB_INFLATE_SUCCESS || d.overflow || d.dest != d.dest_end) {
+			return LIB_INFLATE_DATA_ERROR;
+		}
+#endif
+	}
+	*pLen = pRom->len;
+
+#ifdef LIB_INFLATE_CRC_ENABLED
+	// The build tool may have checked the CRC already 
+	if (!(pRom->flags & LIB_INFLATE_GZROM_CRC_VERIFIED)
+	 && lib_inflate_crc32_update(0, pDest, pRom->len) != pRom->crc) {
+		return LIB_INFLATE_CRC_ERROR;
+	}
+#endif
+	return LIB_INFLATE_SUCCESS;
+}
+
+lib_inflate_error_code lib_inflate_gzromExecute(void *pDest, const lib_inflate_gzrom *pRom) {
+  U4 decSize = pRom->len;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+  lib_inflate_error_code res =
+#endif
+  lib_inflate_gzrom_uncompress(pDest, &decSize, pRom);
+  if (
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+    (res == LIB_INFLATE_SUCCESS) &&
+#endif
+    (decSize == pRom->len)) {
+    EXECUTE(pDest);
+  }
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+  return res;
+#endif
+}
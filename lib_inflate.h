@@ -35,18 +35,36 @@ extern "C" {
 #define ASSERT(x) // dont use
 #define EXECUTE(p)
 #define UNUSED(v) (void)v
+#define U8 unsigned long long
 #define U4 unsigned int
 #define U2 unsigned short
 #define U1 unsigned char
 #define I int
 #define READ_U2(p) (*(U2*)(p))
 #define READ_U4(p) (*(U4*)(p))
+#define WRITE_U2(p,v) (*(U2*)(p) = (v))
 #define lib_crc32 lib_inflate_crc32
 #endif
 
 #define LIB_INFLATE_CRC_ENABLED
 #define LIB_INFLATE_ERROR_ENABLED
 
+#ifndef LIB_INFLATE_THREADS
+ // Max. worker threads on hosts with pthreads, 0 for single threaded targets
+ #define LIB_INFLATE_THREADS 0
+#endif
+#if LIB_INFLATE_THREADS > 0
+ #include <pthread.h>
+#endif
+// Min. bytes per worker thread
+#define LIB_INFLATE_THREADS_CHUNK (1 << 20)
+
+#ifndef LIB_INFLATE_TABLE_BITS
+ // Index bits of the Huffman lookup tables (8..12), 0 to decode bit by bit,
+ // the decoder state grows by 8 << LIB_INFLATE_TABLE_BITS bytes
+ #define LIB_INFLATE_TABLE_BITS 0
+#endif
+
 /**
  * Status codes returned.
  *
@@ -55,6 +73,7 @@ extern "C" {
 #if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
 typedef enum {
 	LIB_INFLATE_SUCCESS    =  0, //*< Success
+	LIB_INFLATE_READ_ERROR = -1, //*< Reading the input failed
 #ifdef LIB_INFLATE_CRC_ENABLED
   LIB_INFLATE_CRC_ERROR  = -3, //*< Checksum error
 #endif
@@ -95,6 +114,194 @@ lib_inflate_data_error_code lib_inflate_uncompress(
                             void *pDest, U4 *pLen,
                             const void *pSrc, U4 len);
 
+/**
+ * Decompress deflate data like `lib_inflate_uncompress`, with sizes
+ * beyond 4 GB.
+ *
+ * @param pDest pointer to where to place decompressed data
+ * @param pLen pointer to variable containing size of `pDest`
+ * @param pSrc pointer to compressed data
+ * @param len size of compressed data
+ * @return `SUCCESS` on success, error code on error
+ */
+lib_inflate_data_error_code lib_inflate_uncompress64(
+                            void *pDest, U8 *pLen,
+                            const void *pSrc, U8 len);
+
+/**
+ * Decompress the first `*pLen` bytes of deflate data from `pSrc` to `pDest`.
+ *
+ * Stops with success as soon as `pDest` is full, so the time taken depends
+ * on the size of the prefix, not on the size of the stream. Streams that
+ * end before are decompressed completely.
+ *
+ * @param pDest pointer to where to place decompressed data
+ * @param pLen pointer to variable containing size of `pDest`, set to the
+ *             size of the decompressed data on success
+ * @param pSrc pointer to compressed data
+ * @param pSrcLen pointer to variable containing size of compressed data,
+ *                set to the number of bytes used on success
+ * @return `SUCCESS` on success, error code on error
+ */
+lib_inflate_data_error_code lib_inflate_uncompress_prefix(
+                            void *pDest, U4 *pLen,
+                            const void *pSrc, U4 *pSrcLen);
+
+/**
+ * Output segment for scatter-gather decompression.
+ */
+typedef struct {
+	void *pDest; //*< where to place this part of the decompressed data
+	U4 len;      //*< size of `pDest`
+} lib_inflate_segment;
+
+/**
+ * Decompress `len` bytes of deflate data from `pSrc` to a list of segments.
+ *
+ * The decompressed data fills the segments in order, as if they were one
+ * contiguous buffer. Matches may reach back across segment boundaries,
+ * symbols inside a segment are decoded as fast as with a single buffer.
+ *
+ * @param pSegs array of output segments
+ * @param num number of segments
+ * @param pLen set to the size of the decompressed data on success
+ * @param pSrc pointer to compressed data
+ * @param len size of compressed data
+ * @return `SUCCESS` on success, error code on error
+ */
+lib_inflate_data_error_code lib_inflate_uncompress_segments(
+                            const lib_inflate_segment *pSegs, U4 num, U4 *pLen,
+                            const void *pSrc, U4 len);
+
+#ifdef LIB_INFLATE_CRC_ENABLED
+/**
+ * Update a CRC32 with the next `len` bytes from `pData`.
+ *
+ * @param crc CRC32 of the preceding data, 0 at the start
+ * @param pData pointer to the data
+ * @param len size of the data
+ * @return CRC32 including the data
+ */
+U4 lib_inflate_crc32_update(U4 crc, const void *pData, U4 len);
+
+/**
+ * Combine the CRC32 of two consecutive pieces of data.
+ *
+ * Shifts `crc1` by `len2` bytes in GF(2) so pieces can be checksummed
+ * independently and joined afterwards.
+ *
+ * @param crc1 CRC32 of the first piece
+ * @param crc2 CRC32 of the second piece
+ * @param len2 size of the second piece
+ * @return CRC32 of both pieces
+ */
+U4 lib_inflate_crc32_combine(U4 crc1, U4 crc2, U4 len2);
+
+#if LIB_INFLATE_THREADS > 0
+/**
+ * Compute the CRC32 of `len` bytes from `pData` with up to `threads` threads.
+ *
+ * Each thread checksums a chunk of at least `LIB_INFLATE_THREADS_CHUNK`
+ * bytes, the chunks are joined with `lib_inflate_crc32_combine`. Used for
+ * the final check of `lib_inflate_gzip_uncompress`.
+ *
+ * @param pData pointer to the data
+ * @param len size of the data
+ * @param threads max. number of threads, up to `LIB_INFLATE_THREADS`
+ * @return CRC32 of the data
+ */
+U4 lib_inflate_crc32_parallel(const void *pData, U4 len, U4 threads);
+#endif
+#endif
+
+/**
+ * Compiled variants of the block decode loop.
+ *
+ * @see lib_inflate_set_variant
+ */
+typedef enum {
+	LIB_INFLATE_VARIANT_AUTO    = 0, //*< Best variant supported by the cpu
+	LIB_INFLATE_VARIANT_GENERIC = 1, //*< Portable code
+	LIB_INFLATE_VARIANT_BMI2    = 2, //*< x86-64 bzhi/shrx bit extraction
+	LIB_INFLATE_VARIANT_AVX2    = 3, //*< x86-64 BMI2 and 32 byte match copies
+} lib_inflate_variant;
+
+/**
+ * Select the block decode loop variant.
+ *
+ * The best variant is picked via cpuid when the program is loaded, call
+ * this only to force a variant for benchmarking and testing, and only
+ * while no other thread decompresses. Falls back to the next simpler
+ * variant the cpu supports, other targets always use `GENERIC`.
+ *
+ * @param variant the variant to use
+ * @return the variant now in use
+ */
+lib_inflate_variant lib_inflate_set_variant(lib_inflate_variant variant);
+
+#if LIB_INFLATE_TABLE_BITS > 0
+/**
+ * Heuristics that decide per block whether to build the lookup tables.
+ *
+ * Building the tables costs about the same for every block, so they only
+ * pay off for blocks with enough symbols. Deflate does not store the size
+ * of a block, its longest literal/length code hints at it as short codes
+ * come from small blocks, the input and output left bound it.
+ *
+ * @see lib_inflate_set_strategy
+ */
+typedef struct {
+	U4 minSymbols; //*< min. number of symbols the input and output left have room for
+	U4 minCodeLen; //*< min. length of the longest literal/length code of a dynamic block
+} lib_inflate_strategy;
+
+/**
+ * Set the heuristics that decide per block whether to build lookup tables.
+ *
+ * Use `minSymbols` 0 and `minCodeLen` 0 to always build the tables, and
+ * `minSymbols` 0xFFFFFFFF to always decode bit by bit.
+ *
+ * @param pStrategy the heuristics to use, NULL for the defaults
+ */
+void lib_inflate_set_strategy(const lib_inflate_strategy *pStrategy);
+#endif
+
+/**
+ * Maximum number of streams decoded in lockstep.
+ *
+ * Each stream keeps its own decoder state on the stack, about 1.4kB plus
+ * `8 << LIB_INFLATE_TABLE_BITS` bytes of lookup tables, so about 9.6kB
+ * with 10 table bits. More streams fail with `BUF_ERROR`, without error
+ * checks only the first `LIB_INFLATE_MULTI_MAX` are decompressed.
+ *
+ * @see lib_inflate_uncompress_multi, lib_inflate_gzip_uncompress_multi
+ */
+#define LIB_INFLATE_MULTI_MAX 4
+
+/**
+ * One of several independent streams to decompress.
+ */
+typedef struct {
+	void *pDest;      //*< where to place decompressed data
+	U4 len;           //*< size of `pDest` on entry, size of the decompressed data on success
+	const void *pSrc; //*< compressed data
+	U4 srcLen;        //*< size of compressed data
+} lib_inflate_stream;
+
+/**
+ * Decompress up to `LIB_INFLATE_MULTI_MAX` independent deflate streams.
+ *
+ * The streams are advanced in turn, one symbol each, so the serial
+ * dependency chains of their Huffman decoding overlap in the core.
+ * Behaves like calling `lib_inflate_uncompress` for each stream.
+ *
+ * @param pStreams array of streams, `len` is updated on success
+ * @param num number of streams
+ * @return `SUCCESS` on success, error code of the first failing stream on error
+ */
+lib_inflate_data_error_code lib_inflate_uncompress_multi(
+                            lib_inflate_stream *pStreams, U4 num);
+
 /**
  * Decompress `len` bytes of gzip data from `pSrc` to `pDest`.
  *
@@ -114,9 +321,359 @@ lib_inflate_error_code lib_inflate_gzip_uncompress(
                             void *pDest, U4 *pLen,
                             const void *pSrc, U4 len);
 
+/**
+ * Decompress gzip data like `lib_inflate_gzip_uncompress`, with sizes
+ * beyond 4 GB.
+ *
+ * The trailer only holds the size modulo 2^32, so it is not used to check
+ * the room in `pDest` up front: data that does not fit fails with
+ * `BUF_ERROR`. The size of the decompressed data is checked against the
+ * trailer modulo 2^32.
+ *
+ * @param pDest pointer to where to place decompressed data
+ * @param pLen pointer to variable containing size of `pDest`
+ * @param pSrc pointer to compressed data
+ * @param len size of compressed data
+ * @return `SUCCESS` on success, error code on error
+ */
+lib_inflate_error_code lib_inflate_gzip_uncompress64(
+                            void *pDest, U8 *pLen,
+                            const void *pSrc, U8 len);
+
+/**
+ * Decompress the first `*pLen` bytes of gzip data from `pSrc` to `pDest`.
+ *
+ * Gzip counterpart of `lib_inflate_uncompress_prefix`, to sniff the start
+ * of a payload. The trailer is checked whenever the decoder reaches the
+ * end of the stream within `pDest`.
+ *
+ * @param pDest pointer to where to place decompressed data
+ * @param pLen pointer to variable containing size of `pDest`, set to the
+ *             size of the decompressed data on success
+ * @param pSrc pointer to compressed data
+ * @param pSrcLen pointer to variable containing size of compressed data,
+ *                set to the number of bytes used on success
+ * @return `SUCCESS` on success, error code on error
+ */
+lib_inflate_error_code lib_inflate_gzip_uncompress_prefix(
+                            void *pDest, U4 *pLen,
+                            const void *pSrc, U4 *pSrcLen);
+
+/**
+ * Decompress `len` bytes of gzip data from `pSrc` to a list of segments.
+ *
+ * Gzip counterpart of `lib_inflate_uncompress_segments`, for when no single
+ * buffer of `lib_inflate_gzip_size` bytes can be allocated.
+ *
+ * @param pSegs array of output segments
+ * @param num number of segments
+ * @param pLen set to the size of the decompressed data on success
+ * @param pSrc pointer to compressed data
+ * @param len size of compressed data
+ * @return `SUCCESS` on success, error code on error
+ */
+lib_inflate_error_code lib_inflate_gzip_uncompress_segments(
+                            const lib_inflate_segment *pSegs, U4 num, U4 *pLen,
+                            const void *pSrc, U4 len);
+
+/**
+ * Decompress up to `LIB_INFLATE_MULTI_MAX` independent gzip streams.
+ *
+ * Gzip counterpart of `lib_inflate_uncompress_multi`.
+ *
+ * @param pStreams array of streams, `len` is updated on success
+ * @param num number of streams
+ * @return `SUCCESS` on success, error code of the first failing stream on error
+ */
+lib_inflate_error_code lib_inflate_gzip_uncompress_multi(
+                            lib_inflate_stream *pStreams, U4 num);
+
+/**
+ * Size of the circular window needed by `lib_inflate_gzip_verify` and
+ * `lib_inflate_gzip_uncompress_stream`.
+ */
+#define LIB_INFLATE_WINDOW_SIZE 32768
+
+/**
+ * Input callback of a streaming decoder.
+ *
+ * The piece must stay valid until the next call.
+ *
+ * @param pCtx context given to the decoder
+ * @param ppData set to the next piece of compressed data
+ * @return size of the piece, 0 at the end of the input
+ */
+typedef U4 (*lib_inflate_read_fn)(void *pCtx, const U1 **ppData);
+
+/**
+ * Output callback of a streaming decoder.
+ *
+ * Called with each full window and with the rest at the end.
+ *
+ * @param pCtx context given to the decoder
+ * @param pData decompressed data
+ * @param len size of the decompressed data
+ */
+typedef void (*lib_inflate_write_fn)(void *pCtx, const U1 *pData, U4 len);
+
+/**
+ * Decompress gzip data pulled piece by piece from `read`.
+ *
+ * Decompresses into a circular window and hands it to `write` whenever it
+ * is full. Decoding can start as soon as the first piece of input arrives,
+ * `read` may block until more data is available. The input must be a
+ * single gzip member: after the trailer `read` is called until it returns
+ * 0, any further data is an error.
+ *
+ * @param read input callback
+ * @param write output callback or NULL
+ * @param pCtx context of the callbacks
+ * @param pWindow pointer to a window of `LIB_INFLATE_WINDOW_SIZE` bytes
+ * @param pLen set to the size of the decompressed data
+ * @return `SUCCESS` on success, error code on error
+ */
+lib_inflate_error_code lib_inflate_gzip_uncompress_stream(
+                            lib_inflate_read_fn read, lib_inflate_write_fn write,
+                            void *pCtx, void *pWindow, U4 *pLen);
+
+/**
+ * Decompress gzip data pulled from `read` like
+ * `lib_inflate_gzip_uncompress_stream`, with the full size of outputs
+ * beyond 4 GB. The trailer is checked modulo 2^32.
+ *
+ * @param read input callback
+ * @param write output callback or NULL
+ * @param pCtx context of the callbacks
+ * @param pWindow pointer to a window of `LIB_INFLATE_WINDOW_SIZE` bytes
+ * @param pLen set to the size of the decompressed data
+ * @return `SUCCESS` on success, error code on error
+ */
+lib_inflate_error_code lib_inflate_gzip_uncompress_stream64(
+                            lib_inflate_read_fn read, lib_inflate_write_fn write,
+                            void *pCtx, void *pWindow, U8 *pLen);
+
+/**
+ * Version of the decoder state snapshots.
+ */
+#define LIB_INFLATE_STATE_VERSION 2
+
+/**
+ * Max. size of a decoder state snapshot, the window and up to 193 bytes of state.
+ */
+#define LIB_INFLATE_STATE_SIZE (LIB_INFLATE_WINDOW_SIZE + 193)
+
+/**
+ * Snapshot callback of a resumable decoder.
+ *
+ * Called after each window, at the next symbol or block boundary. The
+ * snapshot is only valid during the call, persist it to resume later.
+ *
+ * @param pCtx context given to the decoder
+ * @param pState serialised decoder state
+ * @param len size of the state, at most `LIB_INFLATE_STATE_SIZE`
+ */
+typedef void (*lib_inflate_save_fn)(void *pCtx, const U1 *pState, U4 len);
+
+/**
+ * Decompress gzip data pulled from `read`, resumable from a snapshot.
+ *
+ * Works like `lib_inflate_gzip_uncompress_stream` and hands a snapshot of
+ * the decoder to `save` after each window. The snapshot holds the bit
+ * reader, the block type and trees, the window, the CRC32 and the
+ * counters. If the input breaks off, decoding can continue later from the
+ * last snapshot: `read` must then supply the input from the compressed
+ * offset of the snapshot, and `write` gets the output from its
+ * decompressed offset on, see `lib_inflate_state_offsets`.
+ *
+ * @param read input callback
+ * @param write output callback or NULL
+ * @param save snapshot callback or NULL
+ * @param pCtx context of the callbacks
+ * @param pWindow pointer to a window of `LIB_INFLATE_WINDOW_SIZE` bytes
+ * @param pState pointer to `LIB_INFLATE_STATE_SIZE` bytes for the
+ *               snapshots, holding the snapshot to resume from on entry
+ * @param stateLen size of the snapshot to resume from, 0 to start anew
+ * @param pLen set to the size of the decompressed data
+ * @return `SUCCESS` on success, error code on error
+ */
+lib_inflate_error_code lib_inflate_gzip_uncompress_resume(
+                            lib_inflate_read_fn read, lib_inflate_write_fn write,
+                            lib_inflate_save_fn save, void *pCtx, void *pWindow,
+                            void *pState, U4 stateLen, U4 *pLen);
+
+/**
+ * Decompress gzip data pulled from `read`, resumable from a snapshot, like
+ * `lib_inflate_gzip_uncompress_resume`, with the full size of outputs
+ * beyond 4 GB.
+ *
+ * @param read input callback
+ * @param write output callback or NULL
+ * @param save snapshot callback or NULL
+ * @param pCtx context of the callbacks
+ * @param pWindow pointer to a window of `LIB_INFLATE_WINDOW_SIZE` bytes
+ * @param pState pointer to `LIB_INFLATE_STATE_SIZE` bytes for the
+ *               snapshots, holding the snapshot to resume from on entry
+ * @param stateLen size of the snapshot to resume from, 0 to start anew
+ * @param pLen set to the size of the decompressed data
+ * @return `SUCCESS` on success, error code on error
+ */
+lib_inflate_error_code lib_inflate_gzip_uncompress_resume64(
+                            lib_inflate_read_fn read, lib_inflate_write_fn write,
+                            lib_inflate_save_fn save, void *pCtx, void *pWindow,
+                            void *pState, U4 stateLen, U8 *pLen);
+
+/**
+ * Get the offsets to continue from after restoring a snapshot.
+ *
+ * @param pState serialised decoder state
+ * @param len size of the state
+ * @param pSrcOffset set to the offset in the compressed data
+ * @param pDestOffset set to the offset in the decompressed data
+ * @return 1 if the state has a known version, 0 otherwise
+ */
+I lib_inflate_state_offsets(const void *pState, U4 len, U8 *pSrcOffset, U8 *pDestOffset);
+
+#if LIB_INFLATE_THREADS > 0
+/**
+ * Size of the buffers of a read-ahead input stage.
+ */
+#define LIB_INFLATE_READAHEAD_BLOCK 65536
+
+/**
+ * Max. number of buffers of a read-ahead input stage.
+ */
+#define LIB_INFLATE_READAHEAD_MAX 16
+
+/**
+ * Read-ahead input stage for files and pipes on hosts.
+ *
+ * A reader thread fills a pool of `depth` buffers ahead of the decoder,
+ * so reading and decompressing overlap. Regular files are mapped instead
+ * if requested.
+ *
+ * @see lib_inflate_readahead_open, lib_inflate_readahead_read
+ */
+typedef struct {
+	int fd;                              //*< file or pipe to read from
+	int wake[2];                         //*< pipe that wakes the reader on close
+	U1 *pPool;                           //*< depth * LIB_INFLATE_READAHEAD_BLOCK bytes
+	U4 depth;                            //*< number of buffers
+	U4 len[LIB_INFLATE_READAHEAD_MAX];   //*< bytes in each filled buffer
+	U4 head;                             //*< next filled buffer
+	U4 count;                            //*< number of filled buffers
+	I held;                              //*< the head buffer is in use by the decoder
+	I eof;                               //*< the reader reached the end of the input
+	I error;                             //*< errno of a failed read, 0 if none
+	I stop;                              //*< the reader is asked to stop
+	I threaded;                          //*< the reader thread is running
+	const U1 *pMap;                      //*< mapped file or NULL
+	U8 mapLen;                           //*< size of the mapped file
+	U8 mapPos;                           //*< bytes of the mapped file handed out
+	pthread_t thread;                    //*< reader thread
+	pthread_mutex_t lock;                //*< protects the buffer counts
+	pthread_cond_t filled;               //*< signalled when a buffer was filled
+	pthread_cond_t freed;                //*< signalled when a buffer was recycled
+} lib_inflate_readahead;
+
+/**
+ * Start a read-ahead input stage on `fd`.
+ *
+ * Buffers are recycled once the decoder asks for the next one, nothing
+ * is allocated while reading. The input starts at the current position
+ * of `fd`, also when the file is mapped. A failed read ends the input
+ * and sets `error`.
+ *
+ * @param pRa stage to initialise
+ * @param fd file or pipe to read from
+ * @param pPool pointer to `depth * LIB_INFLATE_READAHEAD_BLOCK` bytes,
+ *              may be NULL if `fd` is a regular file and `useMmap` is set
+ * @param depth number of buffers to read ahead, 2 to `LIB_INFLATE_READAHEAD_MAX`
+ * @param useMmap map regular files instead of reading them
+ * @return 1 on success, 0 if the stage could not be started
+ */
+I lib_inflate_readahead_open(lib_inflate_readahead *pRa, int fd,
+                            void *pPool, U4 depth, I useMmap);
+
+/**
+ * Input callback of a read-ahead stage, pass the stage as context.
+ *
+ * @see lib_inflate_read_fn
+ */
+U4 lib_inflate_readahead_read(void *pCtx, const U1 **ppData);
+
+/**
+ * Stop a read-ahead input stage, the file descriptor stays open.
+ *
+ * The reader thread is woken up if it waits for input, so this returns
+ * even if the writer of a pipe keeps it open. Data already read ahead
+ * but not handed to the decoder is dropped, the file position of `fd`
+ * is past it.
+ *
+ * @param pRa stage from `lib_inflate_readahead_open`
+ */
+void lib_inflate_readahead_close(lib_inflate_readahead *pRa);
+
+/**
+ * Decompress gzip data from a file or pipe through a read-ahead stage.
+ *
+ * @param fd file or pipe to read from
+ * @param write output callback or NULL
+ * @param pCtx context of `write`
+ * @param pWindow pointer to a window of `LIB_INFLATE_WINDOW_SIZE` bytes
+ * @param pPool pointer to `depth * LIB_INFLATE_READAHEAD_BLOCK` bytes
+ * @param depth number of buffers to read ahead
+ * @param useMmap map regular files instead of reading them
+ * @param pLen set to the size of the decompressed data
+ * @return `SUCCESS` on success, `READ_ERROR` if reading `fd` failed,
+ *         error code on error
+ */
+lib_inflate_error_code lib_inflate_gzip_uncompress_file(int fd,
+                            lib_inflate_write_fn write, void *pCtx, void *pWindow,
+                            void *pPool, U4 depth, I useMmap, U4 *pLen);
+
+/**
+ * Decompress gzip data from a file or pipe through a read-ahead stage like
+ * `lib_inflate_gzip_uncompress_file`, with the full size of outputs beyond
+ * 4 GB.
+ *
+ * @param fd file or pipe to read from
+ * @param write output callback or NULL
+ * @param pCtx context of `write`
+ * @param pWindow pointer to a window of `LIB_INFLATE_WINDOW_SIZE` bytes
+ * @param pPool pointer to `depth * LIB_INFLATE_READAHEAD_BLOCK` bytes
+ * @param depth number of buffers to read ahead
+ * @param useMmap map regular files instead of reading them
+ * @param pLen set to the size of the decompressed data
+ * @return `SUCCESS` on success, `READ_ERROR` if reading `fd` failed,
+ *         error code on error
+ */
+lib_inflate_error_code lib_inflate_gzip_uncompress_file64(int fd,
+                            lib_inflate_write_fn write, void *pCtx, void *pWindow,
+                            void *pPool, U4 depth, I useMmap, U8 *pLen);
+#endif
+
+/**
+ * Verify `len` bytes of gzip data from `pSrc` without keeping the output.
+ *
+ * Decompresses into a circular window and checks the length and the CRC32
+ * of the decompressed data against the gzip trailer on the fly. The data
+ * must be a single gzip member, anything after its trailer is an error.
+ *
+ * @param pSrc pointer to compressed data
+ * @param len size of compressed data
+ * @param pWindow pointer to a window of `LIB_INFLATE_WINDOW_SIZE` bytes
+ * @return `SUCCESS` if the data is intact, error code on error
+ */
+lib_inflate_error_code lib_inflate_gzip_verify(
+                            const void *pSrc, U4 len, void *pWindow);
+
 /**
  * get the size of uncompressed gzip data from `pSrc`.
  *
+ * The trailer holds the size modulo 2^32, larger data reports the wrong
+ * size, decompress it once with `lib_inflate_gzip_uncompress_stream64`
+ * to get the full size.
+ *
  * @param pSrc pointer to compressed data
  * @param iSrc size of compressed data
  * @return the size of the uncompressed data
@@ -133,8 +690,218 @@ U4 lib_inflate_gzip_size(const void *pSrc, U4 len);
  */
  lib_inflate_error_code lib_inflate_gzipromExecute(void *pDest, const void *pSrc, U4 len);
 
+/**
+ * Huffman decode tree, public for the prebuilt trees of a gzrom container.
+ */
+typedef struct lib_inflate_tree {
+	U2 counts[16];   //*< number of codes with a given length
+	U2 symbols[288]; //*< symbols sorted by code
+	I max_sym;       //*< largest symbol, -1 for an empty tree
+} lib_inflate_tree;
+
+/**
+ * Block of a gzrom container.
+ */
+typedef struct {
+	U4 srcOffset;  //*< offset of the block data in `pData` in bytes
+	U4 srcLen;     //*< size of the block data up to the end of block code in bytes
+	U4 destOffset; //*< offset of the decompressed block in the decompressed data
+	U4 destLen;    //*< size of the decompressed block
+	U2 btype;      //*< 0 uncompressed, 1 fixed or 2 dynamic Huffman codes
+	U2 tree;       //*< index of the literal/length tree, the distance tree follows
+} lib_inflate_gzrom_block;
+
+/**
+ * Block of a gzip image as found by `lib_inflate_gzrom_scan`.
+ */
+typedef struct {
+	U4 srcBitOffset; //*< offset of the block data after the block header in bits
+	U4 srcBitLen;    //*< size of the block data up to the end of block code in bits
+	U4 destOffset;   //*< offset of the decompressed block in the decompressed data
+	U4 destLen;      //*< size of the decompressed block
+	U4 btype;        //*< 0 uncompressed, 1 fixed or 2 dynamic Huffman codes
+	U4 tree;         //*< index of the literal/length tree, the distance tree follows
+} lib_inflate_gzrom_scan_block;
+
+/**
+ * The CRC32 of a gzrom container was checked when it was built.
+ */
+#define LIB_INFLATE_GZROM_CRC_VERIFIED 1
+
+/**
+ * gzrom container, a gzip image prepared at build time for a fast boot.
+ *
+ * The block headers are decoded already, their trees are kept in ROM
+ * and the data of each block starts on a byte boundary. Built from a
+ * gzip file with host/gzrom_build.c.
+ */
+typedef struct {
+	U4 flags;                              //*< `LIB_INFLATE_GZROM_...` flags
+	U4 crc;                                //*< CRC32 of the decompressed data
+	U4 len;                                //*< size of the decompressed data
+	U4 num;                                //*< number of blocks
+	U4 numTrees;                           //*< number of trees
+	U4 dataLen;                            //*< size of the block data
+	const lib_inflate_gzrom_block *pBlocks; //*< blocks
+	const lib_inflate_tree *pTrees;        //*< trees the blocks refer to
+	const U1 *pData;                       //*< block data
+} lib_inflate_gzrom;
+
+/**
+ * Decode a gzip image block by block for building a gzrom container.
+ *
+ * Decompresses the image and records the position of each block's data
+ * in bits and the trees of each block. With `pBlocks` and `pTrees` NULL
+ * only the blocks are counted.
+ *
+ * @param pBlocks pointer to where to place the blocks or NULL
+ * @param pTrees pointer to where to place two trees per block or NULL
+ * @param pNum pointer to variable containing the size of `pBlocks` in
+ *             entries, set to the number of blocks on success
+ * @param pDest pointer to where to place decompressed data
+ * @param pLen pointer to variable containing size of `pDest`, set to the
+ *             size of the decompressed data on success
+ * @param pSrc pointer to the gzip image
+ * @param len size of the gzip image
+ * @return `SUCCESS` on success, error code on error
+ */
+lib_inflate_error_code lib_inflate_gzrom_scan(lib_inflate_gzrom_scan_block *pBlocks,
+                            lib_inflate_tree *pTrees, U4 *pNum,
+                            void *pDest, U4 *pLen, const void *pSrc, U4 len);
+
+/**
+ * Decompress a gzrom container to `pDest`.
+ *
+ * No tree is decoded and no RAM is used for tables. The CRC32 is only
+ * checked if the container is not flagged `LIB_INFLATE_GZROM_CRC_VERIFIED`.
+ * With error checking every block is checked to lie within the block data
+ * and the output and to refer to trees of the container.
+ *
+ * @param pDest pointer to where to place decompressed data
+ * @param pLen pointer to variable containing size of `pDest`, set to the
+ *             size of the decompressed data on success
+ * @param pRom the container
+ * @return `SUCCESS` on success, error code on error
+ */
+lib_inflate_error_code lib_inflate_gzrom_uncompress(void *pDest, U4 *pLen,
+                            const lib_inflate_gzrom *pRom);
+
+/**
+ * execute a gzrom container
+ *
+ * @param pDest pointer to where to place decompressed data and execute it
+ * @param pRom the container
+ * @return `SUCCESS` on success, error code on error
+ */
+lib_inflate_error_code lib_inflate_gzromExecute(void *pDest, const lib_inflate_gzrom *pRom);
+
+/**
+ * Max. decompressed size of a BGZF block.
+ */
+#define LIB_INFLATE_BGZF_BLOCK 65536
+
+/**
+ * Number of decompressed blocks cached by a BGZF reader.
+ */
+#define LIB_INFLATE_BGZF_CACHE 4
+
+/**
+ * Block of a BGZF file, a gzip member with its size in a "BC" subfield.
+ */
+typedef struct {
+	U4 srcOffset;  //*< offset of the member in the compressed data
+	U4 srcLen;     //*< size of the member
+	U4 destOffset; //*< offset of the decompressed block in the decompressed data
+	U4 destLen;    //*< size of the decompressed block
+} lib_inflate_bgzf_block;
+
+/**
+ * Build the block table of `len` bytes of BGZF data from `pSrc`.
+ *
+ * Only the member headers and trailers are read, nothing is decompressed.
+ * With `pBlocks` NULL only the blocks are counted. Data that decompresses
+ * to more than 4 GB fails with `BUF_ERROR`, the offsets are 32 bit.
+ *
+ * @param pBlocks pointer to where to place the block table or NULL
+ * @param pNum pointer to variable containing the size of `pBlocks` in
+ *             entries, set to the number of blocks on success
+ * @param pSrc pointer to compressed data
+ * @param len size of compressed data
+ * @return `SUCCESS` on success, error code on error
+ */
+lib_inflate_error_code lib_inflate_bgzf_index(
+                            lib_inflate_bgzf_block *pBlocks, U4 *pNum,
+                            const void *pSrc, U4 len);
+
+/**
+ * Decompress all blocks of BGZF data into their offsets of `pDest`.
+ *
+ * Blocks are decompressed by up to `LIB_INFLATE_THREADS` threads.
+ *
+ * @param pDest pointer to where to place decompressed data
+ * @param pLen pointer to variable containing size of `pDest`, set to the
+ *             size of the decompressed data on success
+ * @param pSrc pointer to compressed data
+ * @param pBlocks block table from `lib_inflate_bgzf_index`
+ * @param num number of blocks
+ * @return `SUCCESS` on success, error code of a failing block on error
+ */
+lib_inflate_error_code lib_inflate_bgzf_uncompress(
+                            void *pDest, U4 *pLen, const void *pSrc,
+                            const lib_inflate_bgzf_block *pBlocks, U4 num);
+
+/**
+ * Random access reader for BGZF data.
+ *
+ * Keeps the last `LIB_INFLATE_BGZF_CACHE` decompressed blocks.
+ *
+ * @see lib_inflate_bgzf_open, lib_inflate_bgzf_read
+ */
+typedef struct {
+	const U1 *pSrc;                         //*< compressed data
+	const lib_inflate_bgzf_block *pBlocks;  //*< block table
+	U4 num;                                 //*< number of blocks
+	U1 *pCache;                             //*< LIB_INFLATE_BGZF_CACHE * LIB_INFLATE_BGZF_BLOCK bytes
+	I cached[LIB_INFLATE_BGZF_CACHE];       //*< block in each cache slot, -1 if empty
+	U4 used[LIB_INFLATE_BGZF_CACHE];        //*< last use of each cache slot
+	U4 tick;                                //*< use counter
+} lib_inflate_bgzf_reader;
+
+/**
+ * Prepare a reader for random access to BGZF data.
+ *
+ * @param pReader reader to initialise
+ * @param pSrc pointer to compressed data
+ * @param pBlocks block table from `lib_inflate_bgzf_index`
+ * @param num number of blocks
+ * @param pCache pointer to `LIB_INFLATE_BGZF_CACHE * LIB_INFLATE_BGZF_BLOCK` bytes
+ */
+void lib_inflate_bgzf_open(lib_inflate_bgzf_reader *pReader, const void *pSrc,
+                            const lib_inflate_bgzf_block *pBlocks, U4 num,
+                            void *pCache);
+
+/**
+ * Read decompressed data at a BGZF virtual offset.
+ *
+ * The virtual offset holds the offset of the member in the compressed
+ * data in the upper 48 bits and the offset within its decompressed block
+ * in the lower 16 bits. Reads continue into the following blocks. At the
+ * end of the data the virtual offset is left past the last block, so the
+ * next read returns no data.
+ *
+ * @param pReader reader from `lib_inflate_bgzf_open`
+ * @param pVirtualOffset pointer to the virtual offset, advanced past the data read
+ * @param pDest pointer to where to place the data
+ * @param pLen pointer to variable containing the number of bytes to read,
+ *             set to the number of bytes read, less at the end of the data
+ * @return `SUCCESS` on success, error code on error
+ */
+lib_inflate_error_code lib_inflate_bgzf_read(lib_inflate_bgzf_reader *pReader,
+                            U8 *pVirtualOffset, void *pDest, U4 *pLen);
+
 extern const U4 lib_inflate_gzromSize;
 extern const U1 lib_inflate_gzromFile[];
+extern const lib_inflate_gzrom lib_inflate_gzromImage;
 
 #ifdef __cplusplus
 } // extern "C"
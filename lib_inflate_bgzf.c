@@ -0,0 +1,352 @@
+/*
+ * tinf - tiny inflate library (inflate, gzip, zlib)
+ *
+ * Copyright (c) 2003-2019 Joergen Ibsen
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must
+ *      not claim that you wrote the original software. If you use this
+ *      software in a product, an acknowledgment in the product
+ *      documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must
+ *      not be misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *      distribution.
+ */
+
+#include "lib_inflate.h"
+
+// BGZF (blocked gzip) as written by bgzip: a series of gzip members, each
+// with a "BC" subfield in FEXTRA that holds the size of the member - 1
+
+#if LIB_INFLATE_THREADS > 0
+ #include <pthread.h>
+#endif
+
+#define BGZF_FEXTRA 4
+
+// Find the size of the member at `src` from its "BC" subfield, 0 if none
+static U4 lib_inflate_bgzf_member_size(const U1 *src, U4 len)
+{
+	const U1 *extra;
+	U4 xlen;
+
+	// Check id bytes, method and extra field
+	if (len < 18 || src[0] != 0x1F || src[1] != 0x8B || src[2] != 8
+	 || !(src[3] & BGZF_FEXTRA)) {
+		return 0;
+	}
+	xlen = READ_U2(src + 10);
+	if (xlen > len - 12) {
+		return 0;
+	}
+
+	// Walk the subfields
+	for (extra = src + 12; xlen >= 4; ) {
+		U4 slen = READ_U2(extra + 2);
+		if (slen > xlen - 4) {
+			return 0;
+		}
+		if (extra[0] == 'B' && extra[1] == 'C' && slen == 2) {
+			return READ_U2(extra + 4) + 1;
+		}
+		extra += 4 + slen;
+		xlen -= 4 + slen;
+	}
+	return 0;
+}
+
+lib_inflate_error_code lib_inflate_bgzf_index(
+                            lib_inflate_bgzf_block *pBlocks, U4 *pNum,
+                            const void *pSrc, U4 len)
+{
+	const U1 *src = (const U1 *) pSrc;
+	U4 pos = 0, destOffset = 0, num = 0;
+
+	while (pos < len) {
+		U4 size = lib_inflate_bgzf_member_size(src + pos, len - pos);
+		U4 destLen;
+		if (size < 18 || size > len - pos) {
+#ifdef LIB_INFLATE_ERROR_ENABLED
+			return LIB_INFLATE_DATA_ERROR;
+#else
+			break;
+#endif
+		}
+		destLen = lib_inflate_gzip_size(src + pos, size);
+		// The decompressed offsets must stay within 4 GB, also when counting
+		if (destLen > 0xFFFFFFFF - destOffset) {
+#ifdef LIB_INFLATE_ERROR_ENABLED
+			return LIB_INFLATE_BUF_ERROR;
+#else
+			break;
+#endif
+		}
+		if (pBlocks) {
+#ifdef LIB_INFLATE_ERROR_ENABLED
+			if (num == *pNum) {
+				return LIB_INFLATE_BUF_ERROR;
+			}
+#endif
+			pBlocks[num].srcOffset = pos;
+			pBlocks[num].srcLen = size;
+			pBlocks[num].destOffset = destOffset;
+			pBlocks[num].destLen = destLen;
+		}
+		destOffset += destLen;
+		pos += size;
+		num++;
+	}
+	*pNum = num;
+	return LIB_INFLATE_SUCCESS;
+}
+
+// -- Parallel decompression --
+
+struct lib_inflate_bgzf_job {
+	U1 *dest;
+	const U1 *src;
+	const lib_inflate_bgzf_block *blocks;
+	U4 first; // First block of this job
+	U4 num;   // Number of blocks
+	U4 step;  // Distance between the blocks of this job
+	I res;    // Result of the first failing block
+};
+
+static void *lib_inflate_bgzf_worker(void *arg)
+{
+	struct lib_inflate_bgzf_job *job = (struct lib_inflate_bgzf_job *) arg;
+	U4 i;
+
+	job->res = 0;
+	for (i = job->first; i < job->num; i += job->step) {
+		const lib_inflate_bgzf_block *b = &job->blocks[i];
+		U4 destLen = b->destLen;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+		lib_inflate_error_code res =
+#endif
+		lib_inflate_gzip_uncompress(job->dest + b->destOffset, &destLen,
+		                            job->src + b->srcOffset, b->srcLen);
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+		if (res != LIB_INFLATE_SUCCESS) {
+			job->res = res;
+			break;
+		}
+#endif
+	}
+	return 0;
+}
+
+lib_inflate_error_code lib_inflate_bgzf_uncompress(
+                            void *pDest, U4 *pLen, const void *pSrc,
+                            const lib_inflate_bgzf_block *pBlocks, U4 num)
+{
+#if LIB_INFLATE_THREADS > 0
+	struct lib_inflate_bgzf_job job[LIB_INFLATE_THREADS];
+	pthread_t thread[LIB_INFLATE_THREADS];
+	I started[LIB_INFLATE_THREADS];
+	U4 threads = (num < LIB_INFLATE_THREADS) ? num : LIB_INFLATE_THREADS;
+#else
+	struct lib_inflate_bgzf_job job[1];
+	U4 threads = 1;
+#endif
+	U4 i, destLen = num ? pBlocks[num - 1].destOffset + pBlocks[num - 1].destLen : 0;
+
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	if (destLen > *pLen) {
+		return LIB_INFLATE_BUF_ERROR;
+	}
+#endif
+	// Each job takes every `threads`th block, BGZF blocks are of similar size
+	for (i = 0; i < threads; ++i) {
+		job[i].dest = (U1 *) pDest;
+		job[i].src = (const U1 *) pSrc;
+		job[i].blocks = pBlocks;
+		job[i].first = i;
+		job[i].num = num;
+		job[i].step = threads;
+		job[i].res = 0;
+	}
+#if LIB_INFLATE_THREADS > 0
+	// The first job is done by the calling thread
+	for (i = 1; i < threads; ++i) {
+		started[i] = (pthread_create(&thread[i], 0, lib_inflate_bgzf_worker, &job[i]) == 0);
+	}
+#endif
+	if (threads) {
+		lib_inflate_bgzf_worker(&job[0]);
+	}
+#if LIB_INFLATE_THREADS > 0
+	for (i = 1; i < threads; ++i) {
+		if (started[i]) {
+			pthread_join(thread[i], 0);
+		}
+		else {
+			lib_inflate_bgzf_worker(&job[i]);
+		}
+	}
+#endif
+	*pLen = destLen;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	for (i = 0; i < threads; ++i) {
+		if (job[i].res) {
+			return (lib_inflate_error_code) job[i].res;
+		}
+	}
+#endif
+	return LIB_INFLATE_SUCCESS;
+}
+
+// -- Random access --
+
+void lib_inflate_bgzf_open(lib_inflate_bgzf_reader *pReader, const void *pSrc,
+                            const lib_inflate_bgzf_block *pBlocks, U4 num,
+                            void *pCache)
+{
+	I i;
+
+	pReader->pSrc = (const U1 *) pSrc;
+	pReader->pBlocks = pBlocks;
+	pReader->num = num;
+	pReader->pCache = (U1 *) pCache;
+	for (i = 0; i < LIB_INFLATE_BGZF_CACHE; ++i) {
+		pReader->cached[i] = -1;
+		pReader->used[i] = 0;
+	}
+	pReader->tick = 0;
+}
+
+// Find the block starting at `srcOffset`, returns `num` if there is none
+static U4 lib_inflate_bgzf_find(const lib_inflate_bgzf_reader *pReader, U4 srcOffset)
+{
+	U4 lo = 0, hi = pReader->num;
+
+	while (lo < hi) {
+		U4 mid = lo + (hi - lo) / 2;
+		if (pReader->pBlocks[mid].srcOffset < srcOffset) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	if (lo < pReader->num && pReader->pBlocks[lo].srcOffset == srcOffset) {
+		return lo;
+	}
+	return pReader->num;
+}
+
+// Get the decompressed data of a block from the cache, decompress it into
+// the least recently used slot if it is not cached
+static lib_inflate_error_code lib_inflate_bgzf_fetch(lib_inflate_bgzf_reader *pReader,
+                            U4 block, const U1 **pData)
+{
+	const lib_inflate_bgzf_block *b = &pReader->pBlocks[block];
+	U1 *slot;
+	U4 destLen = LIB_INFLATE_BGZF_BLOCK;
+	I i, lru = 0;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	lib_inflate_error_code res;
+#endif
+
+	for (i = 0; i < LIB_INFLATE_BGZF_CACHE; ++i) {
+		if (pReader->cached[i] == (I) block) {
+			pReader->used[i] = ++pReader->tick;
+			*pData = pReader->pCache + i * LIB_INFLATE_BGZF_BLOCK;
+			return LIB_INFLATE_SUCCESS;
+		}
+		if (pReader->used[i] < pReader->used[lru]) {
+			lru = i;
+		}
+	}
+
+	slot = pReader->pCache + lru * LIB_INFLATE_BGZF_BLOCK;
+	pReader->cached[lru] = -1;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	res = 
+#endif
+	lib_inflate_gzip_uncompress(slot, &destLen, pReader->pSrc + b->srcOffset, b->srcLen);
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	if (res != LIB_INFLATE_SUCCESS) {
+		return res;
+	}
+#endif
+	pReader->cached[lru] = block;
+	pReader->used[lru] = ++pReader->tick;
+	*pData = slot;
+	return LIB_INFLATE_SUCCESS;
+}
+
+lib_inflate_error_code lib_inflate_bgzf_read(lib_inflate_bgzf_reader *pReader,
+                            U8 *pVirtualOffset, void *pDest, U4 *pLen)
+{
+	U1 *dest = (U1 *) pDest;
+	U4 block = lib_inflate_bgzf_find(pReader, (U4) (*pVirtualOffset >> 16));
+	U4 offs = (U4) (*pVirtualOffset & 0xFFFF);
+	U4 left = *pLen;
+	U4 i;
+
+	*pLen = 0;
+#ifdef LIB_INFLATE_ERROR_ENABLED
+	if (block == pReader->num) {
+		return LIB_INFLATE_DATA_ERROR;
+	}
+#endif
+	while (left > 0 && block < pReader->num) {
+		const lib_inflate_bgzf_block *b = &pReader->pBlocks[block];
+		const U1 *data = 0;
+		U4 n;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+		lib_inflate_error_code res;
+#endif
+
+		if (offs >= b->destLen) {
+			// Continue at the next block
+			offs -= b->destLen;
+			block++;
+			continue;
+		}
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+		res = 
+#endif
+		lib_inflate_bgzf_fetch(pReader, block, &data);
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+		if (res != LIB_INFLATE_SUCCESS) {
+			return res;
+		}
+#endif
+		n = (b->destLen - offs < left) ? b->destLen - offs : left;
+		for (i = 0; i < n; ++i) {
+			dest[i] = data[offs + i];
+		}
+		dest += n;
+		offs += n;
+		left -= n;
+		*pLen += n;
+	}
+
+	// Virtual offset of the next byte
+	if (block < pReader->num && offs == pReader->pBlocks[block].destLen
+	 && block + 1 < pReader->num) {
+		block++;
+		offs = 0;
+	}
+	if (block < pReader->num) {
+		*pVirtualOffset = ((U8) pReader->pBlocks[block].srcOffset << 16) | offs;
+	}
+	else if (pReader->num) {
+		// Past the last block, the next read returns no data
+		const lib_inflate_bgzf_block *b = &pReader->pBlocks[pReader->num - 1];
+		*pVirtualOffset = ((U8) b->srcOffset << 16) | b->destLen;
+	}
+	return LIB_INFLATE_SUCCESS;
+}
@@ -0,0 +1,44 @@
+#include "lib_inflate.h"
+
+// gzrom container of sample-5.svg.gz built with host/gzrom_build.c
+
+static const U1 gzromData[] = {
+  /*00000000*/ 0x8b, 0xe3, 0x69, 0x07, 0xe7, 0x7d, 0x7a, 0x3b, 0x36, 0xa6, 0x9f, 0xa6, 0xf7, 0xfb, 0xa2, 0x98,
+  /*00000010*/ 0xe7, 0x19, 0x67, 0x8f, 0xe3, 0x61, 0x57, 0xb0, 0x73, 0xae, 0x50, 0x85, 0x81, 0x79, 0x78, 0x99,
+  /*00000020*/ 0xfa, 0xc6, 0x90, 0x18, 0xe8, 0xb7, 0xc3, 0xae, 0x9f, 0x6e, 0xfb, 0xd7, 0x21, 0xa5, 0xc6, 0x3c,
+  /*00000030*/ 0x7f, 0x1c, 0x0e, 0xdb, 0xb7, 0xe9, 0x69, 0x4c, 0xe3, 0xc1, 0xc0, 0x73, 0xea, 0x8e, 0xea, 0xb6,
+  /*00000040*/ 0x19, 0x60, 0x33, 0xd8, 0xcd, 0x78, 0xb6, 0xc7, 0x6d, 0xb7, 0x37, 0x70, 0x1a, 0xb6, 0xf3, 0xe3,
+  /*00000050*/ 0x78, 0x6e, 0x8c, 0x03, 0x07, 0x24, 0xba, 0xcc, 0xf2, 0x0e, 0x60, 0xf1, 0xde, 0x4d, 0x3d, 0xbc,
+  /*00000060*/ 0x34, 0x66, 0x15, 0x91, 0xa2, 0x96, 0x91, 0xc8, 0x77, 0x58, 0x62, 0x09, 0x59, 0xe8, 0x2c, 0xfa,
+  /*00000070*/ 0x8a, 0xc1, 0xb5, 0x84, 0x31, 0x08, 0x78, 0x2c, 0x13, 0x63, 0x70, 0x01, 0x6b, 0xa1, 0x96, 0x5c,
+  /*00000080*/ 0xde, 0x02, 0x27, 0xcb, 0xc8, 0x14, 0x2d, 0xc6, 0x58, 0x5d, 0xf6, 0xaa, 0x91, 0xa0, 0x3e, 0x81,
+  /*00000090*/ 0xa5, 0x55, 0x9b, 0x5a, 0xa0, 0x84, 0x08, 0x65, 0x26, 0x80, 0x02, 0x52, 0x19, 0xae, 0x36, 0xf6,
+  /*000000a0*/ 0xea, 0x63, 0x73, 0x39, 0x33, 0x5c, 0x2a, 0x52, 0x59, 0xd1, 0xbe, 0x8c, 0x72, 0xaa, 0xb0, 0x66,
+  /*000000b0*/ 0x4e, 0x7a, 0x52, 0x99, 0xac, 0x03, 0x72, 0xb8, 0xac, 0x2a, 0xbd, 0x53, 0x83, 0x4a, 0x78, 0x2d,
+  /*000000c0*/ 0x18, 0x7d, 0x6c, 0x09, 0xf4, 0xc2, 0xd7, 0x57, 0xb1, 0x4f, 0x5f, 0x68, 0xd6, 0x85, 0xe0, 0x35,
+  /*000000d0*/ 0x4c, 0xe8, 0x28, 0x13, 0x5f, 0x49, 0xe8, 0x1a, 0x2d, 0x80, 0x4b, 0x15, 0x12, 0xd7, 0x2a, 0x8d,
+  /*000000e0*/ 0x25, 0x3f, 0xfc, 0x04, 0xa5, 0x3c, 0x13, 0x7d, 0xd7, 0x29, 0xa2, 0x08, 0x77, 0x7a, 0xbc, 0x95,
+  /*000000f0*/ 0x2d, 0x0a, 0xd7, 0xea, 0x1f, 0x93, 0x55, 0x2e, 0xe6, 0x16, 0xb1, 0x0a, 0xbf, 0x03, 0xa2, 0xef,
+  /*00000100*/ 0x01, 0xa1, 0x78, 0x20, 0x8f, 0xae, 0xfe, 0xc7, 0x7a, 0x9b, 0xd9, 0xb5, 0x1a, 0xff, 0x41, 0x00,
+  /*00000110*/ 0x3d, 0x69, 0xf2, 0x20, 0xa1, 0xfd, 0x79, 0xeb, 0xc5, 0x14, 0xcb, 0xbb, 0x45, 0xfe, 0xec, 0xe5,
+  /*00000120*/ 0x27,
+};
+
+static const lib_inflate_gzrom_block gzromBlocks[] = {
+  { 0, 289, 0, 532, 2, 0 },
+};
+
+static const lib_inflate_tree gzromTrees[] = {
+  { { 0, 0, 0, 0, 6, 8, 12, 15, 18, 0, 0, 0, 0, 0, 0, 0, },
+    { 32, 46, 49, 50, 54, 257, 34, 45, 48, 51, 52, 56, 108, 258, 47, 53,
+     55, 57, 61, 76, 97, 104, 105, 111, 116, 119, 60, 62, 77, 86, 98, 101,
+     103, 109, 114, 115, 118, 120, 122, 259, 260, 10, 58, 65, 66, 67, 99, 100,
+     102, 110, 112, 117, 256, 261, 262, 263, 264, 265, 266, }, 266 },
+  { { 0, 0, 1, 3, 3, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, },
+    { 11, 10, 12, 15, 8, 13, 16, 2, 6, 7, 9, 14, 17, }, 17 },
+};
+
+const lib_inflate_gzrom lib_inflate_gzromImage = {
+  LIB_INFLATE_GZROM_CRC_VERIFIED, 0x7e3cff25, 532, 1, 2, 289,
+  gzromBlocks, gzromTrees, gzromData
+};
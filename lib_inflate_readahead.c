@@ -0,0 +1,302 @@
+/*
+ * tinf - tiny inflate library (inflate, gzip, zlib)
+ *
+ * Copyright (c) 2003-2019 Joergen Ibsen
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must
+ *      not claim that you wrote the original software. If you use this
+ *      software in a product, an acknowledgment in the product
+ *      documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must
+ *      not be misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *      distribution.
+ */
+
+#include "lib_inflate.h"
+
+// Read-ahead input stage for hosts: a reader thread fills a bounded pool
+// of buffers from a file or pipe while the inflater consumes them
+
+#if LIB_INFLATE_THREADS > 0
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+
+// Largest piece handed out of a mapped file at once
+#define READAHEAD_MAP_PIECE (1U << 30)
+
+static void *lib_inflate_readahead_worker(void *arg)
+{
+	lib_inflate_readahead *pRa = (lib_inflate_readahead *) arg;
+	U4 slot = 0;
+
+	for (;;) {
+		U1 *buf = pRa->pPool + (U8) slot * LIB_INFLATE_READAHEAD_BLOCK;
+		U4 len = 0;
+		I eof = 0;
+		I error = 0;
+
+		// Wait for a free buffer
+		pthread_mutex_lock(&pRa->lock);
+		while (pRa->count == pRa->depth && !pRa->stop) {
+			pthread_cond_wait(&pRa->freed, &pRa->lock);
+		}
+		eof = pRa->stop;
+		pthread_mutex_unlock(&pRa->lock);
+		if (eof) {
+			break;
+		}
+
+		// Fill it, a short read is handed on right away so pipes keep flowing.
+		// Wait for input together with the wake-up pipe, so that close does
+		// not hang on a writer that keeps the pipe open without writing.
+		for (;;) {
+			struct pollfd fds[2];
+			ssize_t n;
+			fds[0].fd = pRa->fd;
+			fds[0].events = POLLIN;
+			fds[1].fd = pRa->wake[0];
+			fds[1].events = POLLIN;
+			if (poll(fds, 2, -1) < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				error = errno;
+				eof = 1;
+				break;
+			}
+			if (fds[1].revents) {
+				eof = 1;
+				break;
+			}
+			n = read(pRa->fd, buf, LIB_INFLATE_READAHEAD_BLOCK);
+			if (n > 0) {
+				len = (U4) n;
+				break;
+			}
+			if (n < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				error = errno;
+			}
+			eof = 1;
+			break;
+		}
+
+		pthread_mutex_lock(&pRa->lock);
+		if (eof) {
+			pRa->eof = 1;
+			pRa->error = error;
+		}
+		else {
+			pRa->len[slot] = len;
+			pRa->count++;
+		}
+		pthread_cond_signal(&pRa->filled);
+		pthread_mutex_unlock(&pRa->lock);
+		if (eof) {
+			break;
+		}
+		slot = (slot + 1) % pRa->depth;
+	}
+	return 0;
+}
+
+I lib_inflate_readahead_open(lib_inflate_readahead *pRa, int fd,
+                            void *pPool, U4 depth, I useMmap)
+{
+	struct stat st;
+	off_t pos;
+
+	pRa->fd = fd;
+	pRa->pPool = (U1 *) pPool;
+	pRa->depth = (depth < 2) ? 2 : (depth > LIB_INFLATE_READAHEAD_MAX) ? LIB_INFLATE_READAHEAD_MAX : depth;
+	pRa->head = 0;
+	pRa->count = 0;
+	pRa->held = 0;
+	pRa->eof = 0;
+	pRa->error = 0;
+	pRa->stop = 0;
+	pRa->pMap = 0;
+	pRa->mapLen = 0;
+	pRa->mapPos = 0;
+	pRa->threaded = 0;
+
+	// Regular files are mapped, the page cache does the read-ahead. The
+	// mapping starts on the page of the current position, like the reader
+	// the data is handed out from that position on.
+	if (useMmap && fstat(fd, &st) == 0 && S_ISREG(st.st_mode)
+	 && (pos = lseek(fd, 0, SEEK_CUR)) >= 0 && pos < st.st_size) {
+		off_t start = pos - pos % sysconf(_SC_PAGESIZE);
+		void *p = mmap(0, (size_t) (st.st_size - start), PROT_READ, MAP_PRIVATE, fd, start);
+		if (p != MAP_FAILED) {
+			madvise(p, (size_t) (st.st_size - start), MADV_SEQUENTIAL);
+			pRa->pMap = (const U1 *) p;
+			pRa->mapLen = (U8) (st.st_size - start);
+			pRa->mapPos = (U8) (pos - start);
+			return 1;
+		}
+	}
+
+	if (!pRa->pPool || pipe(pRa->wake) != 0) {
+		return 0;
+	}
+	pthread_mutex_init(&pRa->lock, 0);
+	pthread_cond_init(&pRa->filled, 0);
+	pthread_cond_init(&pRa->freed, 0);
+	if (pthread_create(&pRa->thread, 0, lib_inflate_readahead_worker, pRa) != 0) {
+		pthread_mutex_destroy(&pRa->lock);
+		pthread_cond_destroy(&pRa->filled);
+		pthread_cond_destroy(&pRa->freed);
+		close(pRa->wake[0]);
+		close(pRa->wake[1]);
+		return 0;
+	}
+	pRa->threaded = 1;
+	return 1;
+}
+
+U4 lib_inflate_readahead_read(void *pCtx, const U1 **ppData)
+{
+	lib_inflate_readahead *pRa = (lib_inflate_readahead *) pCtx;
+	U4 len = 0;
+
+	if (pRa->pMap) {
+		U8 left = pRa->mapLen - pRa->mapPos;
+		len = (left < READAHEAD_MAP_PIECE) ? (U4) left : READAHEAD_MAP_PIECE;
+		*ppData = pRa->pMap + pRa->mapPos;
+		pRa->mapPos += len;
+		return len;
+	}
+	if (!pRa->threaded) {
+		return 0;
+	}
+
+	pthread_mutex_lock(&pRa->lock);
+	// The buffer handed out last time is no longer used, recycle it
+	if (pRa->held) {
+		pRa->held = 0;
+		pRa->head = (pRa->head + 1) % pRa->depth;
+		pRa->count--;
+		pthread_cond_signal(&pRa->freed);
+	}
+	while (pRa->count == 0 && !pRa->eof) {
+		pthread_cond_wait(&pRa->filled, &pRa->lock);
+	}
+	if (pRa->count) {
+		*ppData = pRa->pPool + (U8) pRa->head * LIB_INFLATE_READAHEAD_BLOCK;
+		len = pRa->len[pRa->head];
+		pRa->held = 1;
+	}
+	pthread_mutex_unlock(&pRa->lock);
+	return len;
+}
+
+void lib_inflate_readahead_close(lib_inflate_readahead *pRa)
+{
+	if (pRa->pMap) {
+		munmap((void *) pRa->pMap, (size_t) pRa->mapLen);
+		pRa->pMap = 0;
+	}
+	if (pRa->threaded) {
+		pthread_mutex_lock(&pRa->lock);
+		pRa->stop = 1;
+		pthread_cond_signal(&pRa->freed);
+		pthread_mutex_unlock(&pRa->lock);
+		// Wake the reader if it waits for input
+		while (write(pRa->wake[1], "", 1) < 0 && errno == EINTR) {
+		}
+		pthread_join(pRa->thread, 0);
+		pthread_mutex_destroy(&pRa->lock);
+		pthread_cond_destroy(&pRa->filled);
+		pthread_cond_destroy(&pRa->freed);
+		close(pRa->wake[0]);
+		close(pRa->wake[1]);
+		pRa->threaded = 0;
+	}
+}
+
+// Read and write callbacks share one context in the streaming decoder
+struct lib_inflate_file_ctx {
+	lib_inflate_readahead ra;
+	lib_inflate_write_fn write;
+	void *pCtx;
+};
+
+static U4 lib_inflate_file_read(void *pCtx, const U1 **ppData)
+{
+	return lib_inflate_readahead_read(&((struct lib_inflate_file_ctx *) pCtx)->ra, ppData);
+}
+
+static void lib_inflate_file_write(void *pCtx, const U1 *pData, U4 len)
+{
+	struct lib_inflate_file_ctx *ctx = (struct lib_inflate_file_ctx *) pCtx;
+	if (ctx->write) {
+		ctx->write(ctx->pCtx, pData, len);
+	}
+}
+
+lib_inflate_error_code lib_inflate_gzip_uncompress_file(int fd,
+                            lib_inflate_write_fn write, void *pCtx, void *pWindow,
+                            void *pPool, U4 depth, I useMmap, U4 *pLen)
+{
+	U8 len = 0;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	lib_inflate_error_code res =
+#endif
+	lib_inflate_gzip_uncompress_file64(fd, write, pCtx, pWindow, pPool, depth, useMmap, &len);
+	*pLen = (U4) len;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	return res;
+#endif
+}
+
+lib_inflate_error_code lib_inflate_gzip_uncompress_file64(int fd,
+                            lib_inflate_write_fn write, void *pCtx, void *pWindow,
+                            void *pPool, U4 depth, I useMmap, U8 *pLen)
+{
+	struct lib_inflate_file_ctx ctx;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	lib_inflate_error_code res;
+#endif
+
+	*pLen = 0;
+	if (!lib_inflate_readahead_open(&ctx.ra, fd, pPool, depth, useMmap)) {
+#ifdef LIB_INFLATE_ERROR_ENABLED
+		return LIB_INFLATE_DATA_ERROR;
+#else
+		return LIB_INFLATE_SUCCESS;
+#endif
+	}
+	ctx.write = write;
+	ctx.pCtx = pCtx;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	res =
+#endif
+	lib_inflate_gzip_uncompress_stream64(lib_inflate_file_read, lib_inflate_file_write,
+	                                     &ctx, pWindow, pLen);
+	lib_inflate_readahead_close(&ctx.ra);
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+	// A failed read ends the input like its end, report it instead of
+	// what the decoder made of the truncated data
+	if (ctx.ra.error) {
+		return LIB_INFLATE_READ_ERROR;
+	}
+	return res;
+#endif
+}
+#endif
@@ -23,6 +23,83 @@ const char *urls[] = {
 const char *SSID = "u-Guest"; //"MAZGCH_iot";
 const char *PW = "GqpZvmK8@r5yL#AP";//"xiro1234";
 #define TIMEOUT 2000
+#define MULTI_STREAMS 2 // number of streams for the interleaved decoding test, 0 to disable
+#define SEGMENT_SIZE 16384 // size of the output segments used if the heap has no single block big enough
+#define MAX_SEGMENTS 64
+
+#if MULTI_STREAMS > 0
+// decode the same payload as MULTI_STREAMS streams, back to back and interleaved
+void benchMulti(const uint8_t *pCompressed, unsigned int iCompressedSize, unsigned int iUncompressedSize)
+{
+  lib_inflate_stream streams[MULTI_STREAMS];
+  unsigned long seqTime, multiTime, startTime;
+  int i, n;
+  for (i = 0; i < MULTI_STREAMS; i ++) {
+    streams[i].pDest = malloc(iUncompressedSize);
+    streams[i].pSrc = pCompressed;
+    streams[i].srcLen = iCompressedSize;
+  }
+  for (i = 0; (i < MULTI_STREAMS) && streams[i].pDest; i ++);
+  if (i == MULTI_STREAMS) {
+    startTime = millis();
+    for (n = 0; n < 10; n ++) {
+      for (i = 0; i < MULTI_STREAMS; i ++) {
+        streams[i].len = iUncompressedSize;
+        lib_inflate_gzip_uncompress(streams[i].pDest, &streams[i].len, streams[i].pSrc, streams[i].srcLen);
+      }
+    }
+    seqTime = millis() - startTime;
+    startTime = millis();
+    for (n = 0; n < 10; n ++) {
+      for (i = 0; i < MULTI_STREAMS; i ++) {
+        streams[i].len = iUncompressedSize;
+      }
+      lib_inflate_gzip_uncompress_multi(streams, MULTI_STREAMS);
+    }
+    multiTime = millis() - startTime;
+    Serial.printf("Uncompressed %d streams 10 times back to back in %ldms, interleaved in %ldms\n", 
+      MULTI_STREAMS, seqTime, multiTime);
+  } else {
+    Serial.printf("Not enough memory for %d streams\n", MULTI_STREAMS);
+  }
+  for (i = 0; i < MULTI_STREAMS; i ++) {
+    free(streams[i].pDest);
+  }
+}
+#endif
+
+// decompress into several smaller allocations when a contiguous one fails on a fragmented heap
+void uncompressSegments(const uint8_t *pCompressed, unsigned int iCompressedSize, unsigned int iUncompressedSize)
+{
+  lib_inflate_segment segs[MAX_SEGMENTS];
+  unsigned int num = 0, size = 0, decSize = 0;
+  while ((size < iUncompressedSize) && (num < MAX_SEGMENTS)) {
+    segs[num].len = (iUncompressedSize - size < SEGMENT_SIZE) ? iUncompressedSize - size : SEGMENT_SIZE;
+    segs[num].pDest = malloc(segs[num].len);
+    if (!segs[num].pDest) break;
+    size += segs[num ++].len;
+  }
+  if (size == iUncompressedSize) {
+    unsigned long startTime = millis();
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+    lib_inflate_error_code res = 
+#endif
+    lib_inflate_gzip_uncompress_segments(segs, num, &decSize, pCompressed, iCompressedSize);
+    unsigned long deltaTime = millis() - startTime;
+#if defined(LIB_INFLATE_CRC_ENABLED) || defined(LIB_INFLATE_ERROR_ENABLED)
+    Serial.printf("Uncompressed into %d segments %d compressed %dB uncompressed %dB in %ldms\n", 
+      num, res, iCompressedSize, decSize, deltaTime);
+#else
+    Serial.printf("Uncompressed into %d segments compressed %dB uncompressed %dB in %ldms\n", 
+      num, iCompressedSize, decSize, deltaTime);
+#endif
+  } else {
+    Serial.printf("Not enough memory for %d\n", iUncompressedSize);
+  }
+  while (num > 0) {
+    free(segs[-- num].pDest);
+  }
+}
 
 void setup()
 {
@@ -138,9 +215,12 @@ void setup()
               "Uncompressed %d times compressed %dB uncompressed %dB in %ldms = %ldkB/s\n", n, 
 #endif
               iCompressedSize, decSize, deltaTime, (iCompressedSize * n) / deltaTime);
+#if MULTI_STREAMS > 0
+          benchMulti(pCompressed, iCompressedSize, iUncompressedSize);
+#endif
         }
         else {
-          Serial.printf("Not enough memory for %d\n", iUncompressedSize);
+          uncompressSegments(pCompressed, iCompressedSize, iUncompressedSize);
         }
       } else {
         Serial.println("It's not a gzip file, something went wrong :(");